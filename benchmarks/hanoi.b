@@ -0,0 +1,26 @@
+hanoi: solves the towers of Hanoi for 19 disks and prints every move
+as two letters on a line
+recursion runs on a stack of frames that the program walks with
+unbalanced loops so this stresses pointer movement and scans
+
+>>>>>>>>>>>>>>>>+>>+++++++++++++++++++>>++>+<<<<<[>[->>>>>>>>+>+<<<<<<<<
+<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<+>[[-]<[-]>]<<<<<<<<[->>>>>>>>>+>+<<<
+<<<<<<<]>>>>>>>>>>[-<<<<<<<<<<+>>>>>>>>>>]<-<+>[[-]<[-]>]<<<<<<<<<[->>>>
+>>>>>>+>+<<<<<<<<<<<]>>>>>>>>>>>[-<<<<<<<<<<<+>>>>>>>>>>>]<--<+>[[-]<[-]
+>]<<<[[-]<<<<<<[->>>>>>>>>+>>+<<<<<<<<<<<]>>>>>>>>>>>[-<<<<<<<<<<<+>>>>>
+>>>>>>]<+<[[-]>[-]<<<<<<<<<<[->>>>>>>>>>>>>>>>+<<<<<+<<<<<<<<<<<]>>>>>>>
+>>>>[-<<<<<<<<<<<+>>>>>>>>>>>]>>>>>-<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>+<<
+<<<<+<<<<<<<<<<]>>>>>>>>>>[-<<<<<<<<<<+>>>>>>>>>>]<<<<<<<<[->>>>>>>>>>>>
+>>>+<<<<<<<+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<<<<[->>>>>>>>>>>>
+>>>>>+<<<<<<<<+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]>>>+<<<<<<<<<<<<
+<<<[-]+>>>>>+>>>>>]>[[-]<<<<<<<<<<<<[-]>[-]>[-]>[-]>[-]>[-]>>+>>>>>]<<<<
+]>[[-]<<<<<<[->>>>>>>>+>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<+++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++.[-]<<<<<<<[
+->>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<+++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++.[-]++++++++++.[-]<<<<<<<<<[->
+>>>>>>>>>>>>>>>+<<<<<<<+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]>>>>>>>
+-<<<<<<<<<<<<<[->>>>>>>>>>>>>>+<<<<<<<<+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<<<
+<<<<[->>>>>>>>>>>>>>>>+<<<<<<<<<+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<<<<<<
+<<[->>>>>>>>>>>>>>>>>>+<<<<<<<<<<+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]>
+>>>>+<<<<<<<<<<<<<<<[-]++>>>>>+>>>]>[[-]<<<<<<<<<<[-]>[-]>[-]>[-]>[-]>[-
+]>>+>>>]<<<<[->>>>>>>>>>>>>>>>]>[-<<<<<<<<<<<<<<<<]<<<<<<<]
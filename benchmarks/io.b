@@ -0,0 +1,8 @@
+io: copies its input to its output one byte at a time
+input stops at a zero byte or at 255 so any EOF convention works
+this measures the cost of every single byte of input and output
+
+>>>>>>>>>>>>[-]+[<<<<<<<<<<<<[-],>+<[>-]>[<>>>>>>>>>>>>>>>>+<<<<<<<<<<<<
+<<<<>->]<<+>+<[>-]>[<>>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<>->]<<->>>>>>>>>>>
+>>>>>>+<[[-]>[-]<<<<<[-]>>>>]>[[-]<<<<<<<<<<<<<<<<<.>>>>>>>>>>>>>>>>>]<<
+<<<]
@@ -0,0 +1,170 @@
+mandelbrot: renders the Mandelbrot set as 41 by 21 characters of ASCII
+art with up to 128 iterations per point
+arithmetic is 16 bit fixed point in sign and magnitude cells so the
+program spends its time in long multiplication loops
+
+>>>>>>>>>>>>>>>>>>[-]+>>>[-]++++++++++++++++++++>>>>>>>>>>>>[-]+++++++++
+++++++++++++[-<<<<<<<<<<<<<<<<<<<<<[-]+>>>[-]+++++++++++++++++++++++++++
++++++>>>>>>>>>>>>>>>>>>>>>[-]+++++++++++++++++++++++++++++++++++++++++[-
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>[-]>>>[-]>>>[-]>>>>>>>>>>>>>>>
+[-]>>>[-]+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++>>>[-]+
+[<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<+>
+>>>>>>>>+++++++++++++++++++++++++++++++++[->>>+<<<<<+<[>-]>[<>>>>>>[-]<<
+<<<<<<<<<<[-]>>>>>>>->]<<>>>>>>[[-]<<<<<<->>>>>>]<<<]<<<[-]<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<+>>>>>>++++++++++++++++++++++++++++++
++++[->>>+<<<<<+<[>-]>[<>>>>>>[-]<<<<<<<<<[-]>>>>->]<<>>>>>>[[-]<<<<<<->>
+>>>>]<<<]<<<[-]<<<<<<<<<+>>>[[-]<<<[-]>>>]>>>[[-]<<<<<<[-]>>>>>>]<<<+<<<
+[[-]>>>[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>]<<<++++++++++++++++<<<<<<<<<[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>+>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<[->>>
+>>>->+<[>-]>[<++++++++++++++++<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>->]<
+<<<<<<<]<<<]>>>>>>>>>[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>>>>+<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>]<<<++++++++++++++++<<<<<<<<<[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>
+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<[->>>>>>->+<[>-]>[<++++++++++++++++<<<<<<<
+<<<<<<<<+>>>>>>>>>>>>>>>>->]<<<<<<<<]<<<]>>>>>>>>>[-]<<<<<<<<<<<<<<<<<<[
+->>>>>>>>>+>>>+<<<<<<<<<<<<]>>>>>>>>>>>>[-<<<<<<<<<<<<+>>>>>>>>>>>>]<<<<
+<<<<<[->>>>>>+>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<[->>>>>>+>
+>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<<<<+>>>>>>+++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++[->>>+<<<<<+<[>-]>[<>>
+>>>>[-]<<<<<<<<<[-]>>>>->]<<>>>>>>[[-]<<<<<<->>>>>>]<<<]<<<[-]<<<<<<[-]+
+>>>[[-]<<<[-]<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[
+[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<++++++++<<<<<<<<<[-<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>+>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<[->>>>>>->+
+<[>-]>[<++++++++<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>->]<<<<<<<<]<<<]>>>>>>>>
+>[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[-
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<->+<[
+>-]>[<>>>+<<<>->]<<[-]<<<<<<<<<<<<[->>>>>>>>>>>>+<<<<<<<<<<<<]>>>[->>>>>
+>>>>>>>>>>+<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[[-]<<<[-]<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>+>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<]<<<[[-]<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>+>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>[-]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>+[>>>+<<<<<+<[>-]>[<>>>[-]>>>[-]<<<<<<>->]<<<<
+<<<+<[>-]>[<>>>>>>>>>[-]>>>[-]<<<<<<<<<<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<
+<<<<->>>>>>->>>>>>]<<<]<<<<<<<<+<[>-]>[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>+<[>-]>[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>->]<<<<<<<<>->]<<[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>>
+>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>+<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>]<<<[[-]<<<[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>+<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<]<<<[[-]<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>+>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>]<<<]+<<<<<<[[-]>>>>>>[-]<<<<<<<<<<<<<<<[->>>>>>>>>>>>+<<<<<<<<<<<<]>
+>>>>>>>>]>>>>>>[[-]<<<<<<<<<<<<<<<[->>>>>>+<<<<<<]>>>>>>>>>>>>>>>]<<<<<<
+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>[-]>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+[>>>>>>+<<+<[>-]>[<<<<[-]>>>>
+>>[-]<<<>->]<<<<<<<+<[>-]>[<>>>[-]>>>>>>[-]<<<<<<<<<>->]<<>>>>>>>>>[[-]<
+<<<<<<<<->>>>>>->>>]<<<<<<]<<+<[>-]>[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>>+<[>-]>[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<->
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>->]<<<<<<<<>->]
+<<[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>->+<[>-]>[<>>>[-]<<<>->]<
+<>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<[-]>>>[-]>>>[-]<<<<<<<<<<<<]>>>[[-
+]<<<<<<<<<<<<[-]>>>>>>>>>>>>]<<<<<<<<<<<<]<<<<<<[->>>>>>>>>>>>>>>+>>>>>>
+>>>+<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<
+<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<[-]+>>>>>>[->>>+<<<<<<<<<<<+<[>-]
+>[<>>>>>>>>>>>>[-]<<<<<<<<<[-]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->>>>
+>>>>>>>>]<<<]<<<<<<[[-]>>>[-]++++++++++++++++++++++++++++++++<<<][-]+>>>
+>>>+[->>>+<<<<<<<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<<<<<[-]<<<>->]<<>>>>>>
+>>>>>>[[-]<<<<<<<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]>>>[-]++++++++++++++++
+++++++++++++++++++++++++++++++<<<][-]+>>>>>>+[->>>+<<<<<<<<<<<+<[>-]>[<>
+>>>>>>>>>>>[-]<<<<<<<<<[-]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->>>>>>>>
+>>>>]<<<]<<<<<<[[-]>>>[-]+++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++<<<][-]+>>>>>>+[->>>+<<<<<<<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<
+<<<<[-]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]
+>>>[-]+++++++++++++++++++++++++++++++++++++++++++++<<<][-]+>>>>>>++[->>>
++<<<<<<<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<<<<<[-]<<<>->]<<>>>>>>>>>>>>[[-
+]<<<<<<<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]>>>[-]+++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++<<<][-]+>>>>>>++[->>>+<<<<<<<<<<<+<[
+>-]>[<>>>>>>>>>>>>[-]<<<<<<<<<[-]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->
+>>>>>>>>>>>]<<<]<<<<<<[[-]>>>[-]++++++++++++++++++++++++++++++++++++++++
++++<<<][-]+>>>>>>+++[->>>+<<<<<<<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<<<<<[-
+]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]>>>[-]
+++++++++++++++++++++++++++++++++++++++++++<<<][-]+>>>>>>++++[->>>+<<<<<<
+<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<<<<<[-]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<
+<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]>>>[-]++++++++++++++++++++++++++++++++
++++<<<][-]+>>>>>>++++++[->>>+<<<<<<<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<<<<
+<[-]<<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]>>>
+[-]+++++++++++++++++++++++++++++++++++++<<<][-]+>>>>>>++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++[->>>+<<<<<<<<<<<+<[>-]>[<>>>>>>>>>>>>[-]<<<<<<<<<[-]<
+<<>->]<<>>>>>>>>>>>>[[-]<<<<<<<<<<<<->>>>>>>>>>>>]<<<]<<<<<<[[-]>>>[-]++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++<<<]>>>.<<
+<<<<[-]>>>[-]>>>[-]<<<<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>
+>>>>>>>>>>]<<<[[-]<<<[-]<<<<<<<<<<<<<<<<<<<<<<<<->+<[>-]>[<<<<[-]>>>>->]
+<<>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[[-]<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>
+>>>>>>>>>>>>>>]<<<]>>>++++++++++.[-]+<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>
+>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>
+[-<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[[-]<<<[-]<
+<<<<<<<<<<<<<<<<<-->+<[>-]>[<<<<[-]>>>>->]<<>>>>>>>>>>>>>>>>>>>>>]<<<[[-
+]<<<<<<<<<<<<<<<<<<++>>>>>>>>>>>>>>>>>>]<<<<<<]
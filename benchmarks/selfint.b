@@ -0,0 +1,53 @@
+selfint: a brainfuck interpreter written in brainfuck
+reads a program up to an exclamation mark and runs it on the rest of
+the input
+code and data live in interleaved units of 16 cells and every step
+of the interpreted program walks across the tape
+
+>>>>>>>>>>>>>>>>>>>>>>>+[[-]<<<[-],>+<[>-]>[<>>>>>>>>>[-]+<<<<<<<<<>->]<
+<+>+<[>-]>[<>>>>>>>>>[-]+<<<<<<<<<>->]<<--------------------------------
+-->+<[>-]>[<>>>>>>>>>[-]+<<<<<<<<<>->]<<---------->+<[>-]>[<<<<+>>>>->]<
+<->+<[>-]>[<<<<++++++>>>>->]<<->+<[>-]>[<<<<++>>>>->]<<->+<[>-]>[<<<<+++
+++>>>>->]<<-------------->+<[>-]>[<<<<++++>>>>->]<<-->+<[>-]>[<<<<+++>>>
+>->]<<----------------------------->+<[>-]>[<<<<+++++++>>>>->]<<-->+<[>-
+]>[<<<<++++++++>>>>->]<<++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++++++++++++[-]>>>+>>>>>>[[-]<<<<<<[-]>
+>>>>>]<<<<<<<<<<<<[->>>>>>>>>+>>>+<<<<<<<<<<<<]>>>>>>>>>>>>[-<<<<<<<<<<<
+<+>>>>>>>>>>>>]<<<[[-]<<<[->>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<]>>>>>>>>>>>
+>>>>>>>>]<<<]<<<<<<<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]>>>+[<<<<>>>>>>>>>>
+>>>>>>[>>>>>>>>>>>>>>>>]>[->>>+>>>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<<+<[>-]
+>[<<<<<<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]>>>>[-]<<<<>>>>>>>>>>>>>>>>[>>>
+>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<<<[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>[
+>>>>>>>>>>>>>>>>]>+<<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<
+<<<<<<<<<<<<<<]<>>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<
+<<[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>-<<<<<<<<<<<<<<<<<
+[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<>>>>>>>>>>>>>>>>[>>>
+>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<<<[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>[
+>>>>>>>>>>>>>>>>]+<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<
+<<<<<<<<<<<<]<>>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<<<
+[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<-<<<<
+<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<>>>>>>>>
+>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<<<[>>>>>>>>>>>>>>>>]>>>>
+>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>.<<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<
+<<<<<<<<<[<<<<<<<<<<<<<<<<]<>>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>->]<<
+->+<[>-]>[<<<<[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>[-],<<
+<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<>>>>>
+>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<<<[>>>>>>>>>>>>>>>>]>
+>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>+<[>-]>[<<<<<<<<<<<<<<<<<<[<<<<<<<<<<<
+<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<>>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>
+>]>>>>>>>>>>+<<<<<<<<<[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>
+]>>->]<<<<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<<
+<<<]<>>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>->]<<->+<[>-]>[<<<<[>>>>>>>>
+>>>>>>>>]>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>+<<+<[>-]>[<>>>-<<<>->]<<>
+>>[[-]<<<<<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<
+<<<<]<>>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>+<<<<<<<<<<<<[>>>>>
+>>>>>>>>>>>]>>>>>>>>>>>>>>>[>>>>>>>>>>>>>>>>]>>>>]<<<<<<<<<<<<<<<<<<<<[<
+<<<<<<<<<<<<<<<]<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]<>>>>>>>>>>>>>>>>[>>>>>
+>>>>>>>>>>>]>>>>>->]<<++++++++[-]>>>>>>[[-]<<<<<<+[<<<<+>>>>[->>>>>>>>>>
+>>>>>>+<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>><<<[->>>>>>+>>>>>>+<<<<<<<<<<<<]
+>>>>>>>>>>>>[-<<<<<<<<<<<<+>>>>>>>>>>>>]<<<<<<------->+<[>-]>[<<<<+>>>>-
+>]<<->+<[>-]>[<<<<->>>>->]<<++++++++[-]<<<]>>>>>>]>>>[[-]<<<<<<<<<+[<<<<
+<<<<<<<<<<<<<<<<->>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>
+]<<<<<<<<<<<<<<<<<<<[->>>>>>+>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>
+>]<<<-------->+<[>-]>[<<<<+>>>>->]<<+>+<[>-]>[<<<<->>>>->]<<+++++++[-]<<
+<]>>>>>>>>>]<<<<<<<<<<<<<+<<<<<<<<<<<<<<<<[<<<<<<<<<<<<<<<<]>>>>]
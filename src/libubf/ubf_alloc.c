@@ -0,0 +1,140 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_alloc_c
+#define ubf_alloc_c
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ubf_alloc.h"
+#include "ubf_options.h"
+
+void *ubf__libc_alloc(void *context, void *block, size_t old_size,
+                      size_t new_size) {
+  // libc keeps track of the sizes itself
+  (void) context;
+  (void) old_size;
+  if (new_size == 0) {
+    free(block);
+    return NULL;
+  }
+  return realloc(block, new_size);
+}
+
+const ubf_allocator_t ubf_libc_allocator = { ubf__libc_alloc, NULL };
+
+// Allocations are aligned like malloc's would be.
+#define UBF_ARENA_ALIGNMENT 16
+#define UBF_ARENA_ALIGN(size) \
+  (((size) + UBF_ARENA_ALIGNMENT - 1) & ~(size_t) (UBF_ARENA_ALIGNMENT - 1))
+
+struct ubf_arena_block_ {
+  ubf_arena_block_t *next;
+  // the amount of bytes in the block, and how many of them are allocated
+  size_t size;
+  size_t used;
+};
+
+// The block's memory starts right after its header.
+#define UBF_ARENA_HEADER UBF_ARENA_ALIGN(sizeof(ubf_arena_block_t))
+#define UBF_ARENA_DATA(block) ((uint8_t *) (block) + UBF_ARENA_HEADER)
+
+// Adds a block of at least `size` bytes to the arena, to allocate from next.
+// Blocks double the arena's capacity, so a growing arena needs few of them.
+ubf_arena_block_t *ubf__arena_add_block(ubf_arena_t *arena, size_t size) {
+  if (size < UBF_ARENA_BLOCK_SIZE) size = UBF_ARENA_BLOCK_SIZE;
+  if (size < arena->capacity) size = arena->capacity;
+  ubf_arena_block_t *block = (ubf_arena_block_t *)
+    ubf__allocate(&arena->backing, UBF_ARENA_HEADER + size);
+  if (block == NULL) return NULL;
+  block->next = arena->blocks;
+  block->size = size;
+  block->used = 0;
+  arena->blocks = block;
+  arena->capacity += size;
+  return block;
+}
+
+void *ubf__arena_alloc(void *context, void *block, size_t old_size,
+                       size_t new_size) {
+  ubf_arena_t *arena = (ubf_arena_t *) context;
+  ubf_arena_block_t *top = arena->blocks;
+
+  // the most recent allocation is the only one that can grow or shrink, and
+  // it's given back when it's freed
+  if (block != NULL && block == arena->last) {
+    size_t start = (size_t) ((uint8_t *) block - UBF_ARENA_DATA(top));
+    size_t end = start + UBF_ARENA_ALIGN(new_size);
+    if (end <= top->size) {
+      top->used = end;
+      if (new_size == 0) arena->last = NULL;
+      return (new_size != 0) ? block : NULL;
+    }
+  }
+  // everything else is only given back when the arena is reset
+  if (new_size == 0) return NULL;
+  if (new_size <= old_size) return block;
+
+  size_t size = UBF_ARENA_ALIGN(new_size);
+  if (top == NULL || top->size - top->used < size) {
+    top = ubf__arena_add_block(arena, size);
+    if (top == NULL) return NULL;
+  }
+  void *fresh = UBF_ARENA_DATA(top) + top->used;
+  top->used += size;
+  arena->last = fresh;
+  if (block != NULL) memcpy(fresh, block, old_size);
+  return fresh;
+}
+
+void ubf_init_arena(ubf_arena_t *arena, const ubf_allocator_t *backing) {
+  arena->allocator.alloc = ubf__arena_alloc;
+  arena->allocator.context = arena;
+  arena->backing = *backing;
+  arena->blocks = NULL;
+  arena->capacity = 0;
+  arena->last = NULL;
+}
+
+// Frees all of the arena's blocks.
+void ubf__arena_free_blocks(ubf_arena_t *arena) {
+  ubf_arena_block_t *block = arena->blocks;
+  while (block != NULL) {
+    ubf_arena_block_t *next = block->next;
+    ubf__deallocate(&arena->backing, block, UBF_ARENA_HEADER + block->size);
+    block = next;
+  }
+  arena->blocks = NULL;
+  arena->capacity = 0;
+  arena->last = NULL;
+}
+
+void ubf_reset_arena(ubf_arena_t *arena) {
+  arena->last = NULL;
+  if (arena->blocks == NULL) return;
+  if (arena->blocks->next == NULL) {
+    arena->blocks->used = 0;
+    return;
+  }
+  // an arena that needed several blocks is merged into one, so the next time
+  // around everything fits in it
+  size_t capacity = arena->capacity;
+  ubf__arena_free_blocks(arena);
+  ubf__arena_add_block(arena, capacity);
+}
+
+void ubf_free_arena(ubf_arena_t *arena) {
+  ubf__arena_free_blocks(arena);
+}
+
+#undef UBF_ARENA_ALIGNMENT
+#undef UBF_ARENA_ALIGN
+#undef UBF_ARENA_HEADER
+#undef UBF_ARENA_DATA
+
+#endif
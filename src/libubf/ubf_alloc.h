@@ -0,0 +1,90 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_alloc_h
+#define ubf_alloc_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Allocates, resizes, and frees memory, all in one function. Called with the
+/// allocator's context, a block of memory (NULL to allocate a new one), the
+/// block's current size, and the size it should have (0 to free it). Returns
+/// the block, which may have moved, or NULL if it was freed or there's no
+/// memory left.
+typedef void *(*ubf_alloc_proc)(void *context, void *block, size_t old_size,
+                                size_t new_size);
+
+/// An allocator the memory of VMs and programs comes from.
+typedef struct {
+  ubf_alloc_proc alloc;
+  void *context;
+} ubf_allocator_t;
+
+/// The C standard library's malloc, realloc, and free.
+extern const ubf_allocator_t ubf_libc_allocator;
+
+typedef struct ubf_arena_block_ ubf_arena_block_t;
+
+/// A bump allocator.
+/// Allocations are carved out of large blocks one after the other, and are
+/// only given back all at once, when the arena is reset, which keeps the
+/// blocks around for whatever is allocated next. The most recent allocation
+/// can still be grown and shrunk in place, which is most of what a growing
+/// array does. Arenas aren't thread-safe.
+typedef struct {
+  // hands out memory from this arena, so the arena mustn't move once it's
+  // initialized
+  ubf_allocator_t allocator;
+  // where the blocks come from
+  ubf_allocator_t backing;
+  // the blocks, the one being allocated from first
+  ubf_arena_block_t *blocks;
+  // the total size of the blocks
+  size_t capacity;
+  // the most recent allocation
+  void *last;
+} ubf_arena_t;
+
+/// Initializes an empty arena, which gets its blocks from `backing`.
+void ubf_init_arena(ubf_arena_t *arena, const ubf_allocator_t *backing);
+
+/// Frees everything allocated from an arena at once. The memory is kept for
+/// reuse, in a single block large enough for everything the arena held.
+void ubf_reset_arena(ubf_arena_t *arena);
+
+/// Gives an arena's memory back to its backing allocator.
+void ubf_free_arena(ubf_arena_t *arena);
+
+/// Allocates `size` bytes.
+static inline void *ubf__allocate(const ubf_allocator_t *allocator,
+                                  size_t size) {
+  return allocator->alloc(allocator->context, NULL, 0, size);
+}
+
+/// Allocates `size` zeroed bytes.
+static inline void *ubf__allocate_zeroed(const ubf_allocator_t *allocator,
+                                         size_t size) {
+  void *block = ubf__allocate(allocator, size);
+  if (block != NULL) memset(block, 0, size);
+  return block;
+}
+
+/// Resizes a block from `old_size` to `new_size` bytes.
+static inline void *ubf__reallocate(const ubf_allocator_t *allocator,
+                                    void *block, size_t old_size,
+                                    size_t new_size) {
+  return allocator->alloc(allocator->context, block, old_size, new_size);
+}
+
+/// Frees a block of `size` bytes. NULL is ignored.
+static inline void ubf__deallocate(const ubf_allocator_t *allocator,
+                                   void *block, size_t size) {
+  if (block != NULL) allocator->alloc(allocator->context, block, size, 0);
+}
+
+#endif
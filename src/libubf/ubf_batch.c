@@ -0,0 +1,393 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_batch_c
+#define ubf_batch_c
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ubf_batch.h"
+#include "ubf_io.h"
+#include "ubf_options.h"
+
+// A worker's share of the jobs, [head, tail). The owner takes jobs from the
+// head, thieves take them from the tail, so the two rarely meet.
+typedef struct {
+  pthread_mutex_t lock;
+  size_t head;
+  size_t tail;
+} ubf__batch_queue_t;
+
+typedef struct {
+  // the job's buffered output, for ordered output
+  FILE *output;
+  bool done;
+} ubf__batch_job_t;
+
+typedef struct {
+  ubf_program_t *program;
+  const ubf_batch_t *batch;
+  unsigned threads;
+  ubf__batch_queue_t *queues;
+  ubf__batch_job_t *jobs;
+  // ordered output is written by whichever worker finishes the job that's
+  // next in line. Jobs are handed out in order, and only so far ahead of the
+  // output, so the jobs waiting for their turn don't pile up
+  pthread_mutex_t output_lock;
+  pthread_cond_t output_done;
+  size_t next_job;
+  size_t next_output;
+  // set while a worker is writing out output; the lock only guards claiming
+  // jobs, and the writer copies them outside of it, so this keeps a second
+  // worker from writing at the same time and mixing up the order
+  bool writing;
+  // what the writer copies through, UBF_OUTPUT_BUFFER_SIZE bytes; there's
+  // only ever one writer, and it's too big for a worker's stack
+  uint8_t *copy_buffer;
+  atomic_size_t failed;
+  _Atomic uint64_t input_bytes;
+  _Atomic uint64_t output_bytes;
+} ubf__batch_state_t;
+
+typedef struct {
+  ubf__batch_state_t *state;
+  unsigned index;
+  pthread_t thread;
+} ubf__batch_worker_t;
+
+void ubf_init_batch(ubf_batch_t *batch) {
+  batch->inputs = NULL;
+  batch->count = 0;
+  batch->threads = 0;
+  batch->engine = UBF_ENGINE_INTERPRETER;
+  batch->eof = UBF_EOF_MINUS_ONE;
+  batch->cell_width = UBF_CELL_8;
+  batch->overflow = UBF_OVERFLOW_WRAP;
+  batch->fuel = 0;
+  batch->max_tape = 0;
+  batch->max_output = 0;
+  batch->output = UBF_BATCH_ORDERED;
+  batch->output_fd = STDOUT_FILENO;
+  batch->headers = false;
+  batch->output_dir = NULL;
+}
+
+// Takes the next job for ordered output, the first one that hasn't been
+// started yet. Waits while too many jobs are done but still waiting for an
+// earlier one; the earliest of them is always running, so that never takes
+// longer than the job.
+// Returns false once there are no jobs left.
+bool ubf__batch_take_ordered(ubf__batch_state_t *state, size_t *job) {
+  const size_t ahead = state->threads + UBF_BATCH_MAX_PENDING;
+  pthread_mutex_lock(&state->output_lock);
+  while (state->next_job < state->batch->count
+         && state->next_job - state->next_output >= ahead) {
+    pthread_cond_wait(&state->output_done, &state->output_lock);
+  }
+  bool found = state->next_job < state->batch->count;
+  if (found) *job = state->next_job++;
+  pthread_mutex_unlock(&state->output_lock);
+  return found;
+}
+
+// Takes the next job for a worker, stealing one if its own queue is empty.
+// Returns false once there are no jobs left anywhere.
+bool ubf__batch_take(ubf__batch_state_t *state, unsigned index, size_t *job) {
+  if (state->batch->output == UBF_BATCH_ORDERED) {
+    return ubf__batch_take_ordered(state, job);
+  }
+
+  ubf__batch_queue_t *own = &state->queues[index];
+  pthread_mutex_lock(&own->lock);
+  bool found = own->head < own->tail;
+  if (found) *job = own->head++;
+  pthread_mutex_unlock(&own->lock);
+  if (found) return true;
+
+  for (unsigned i = 1; i < state->threads; i++) {
+    ubf__batch_queue_t *victim = &state->queues[(index + i) % state->threads];
+    pthread_mutex_lock(&victim->lock);
+    found = victim->head < victim->tail;
+    if (found) *job = --victim->tail;
+    pthread_mutex_unlock(&victim->lock);
+    if (found) return true;
+  }
+  return false;
+}
+
+// Copies a finished job's buffered output to the batch's output.
+void ubf__batch_copy(ubf__batch_state_t *state, size_t job) {
+  const ubf_batch_t *batch = state->batch;
+  FILE *output = state->jobs[job].output;
+  if (batch->headers) {
+    const char *input = batch->inputs[job];
+    struct iovec iov[3] = {
+      { (void *) "==> ", 4 },
+      { (void *) input, strlen(input) },
+      { (void *) " <==\n", 5 }
+    };
+    ubf__write_all(batch->output_fd, iov, 3);
+  }
+  if (output == NULL) return;
+
+  uint8_t *buffer = state->copy_buffer;
+  int fd = fileno(output);
+  lseek(fd, 0, SEEK_SET);
+  ssize_t readlen;
+  while ((readlen = read(fd, buffer, UBF_OUTPUT_BUFFER_SIZE)) != 0) {
+    if (readlen < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    struct iovec iov = { buffer, (size_t) readlen };
+    ubf__write_all(batch->output_fd, &iov, 1);
+  }
+  fclose(output);
+  state->jobs[job].output = NULL;
+}
+
+// Marks a job as done, and writes out the output of every job that's now
+// ready to go in order. If another worker is already writing, it picks the
+// job up once it's done with the ones it claimed, so this returns right away.
+void ubf__batch_finish(ubf__batch_state_t *state, size_t job) {
+  pthread_mutex_lock(&state->output_lock);
+  state->jobs[job].done = true;
+  if (!state->writing) {
+    state->writing = true;
+    while (true) {
+      // claim the run of jobs that are ready, and copy them without holding
+      // up the workers that are finishing or taking jobs meanwhile
+      size_t first = state->next_output;
+      size_t last = first;
+      while (last < state->batch->count && state->jobs[last].done) {
+        last++;
+      }
+      if (last == first) break;
+      pthread_mutex_unlock(&state->output_lock);
+      for (size_t i = first; i < last; i++) {
+        ubf__batch_copy(state, i);
+      }
+      pthread_mutex_lock(&state->output_lock);
+      // only now are the jobs' temporary files closed, so more jobs can start
+      state->next_output = last;
+      pthread_cond_broadcast(&state->output_done);
+    }
+    state->writing = false;
+  }
+  pthread_mutex_unlock(&state->output_lock);
+}
+
+// Opens the file a job's output goes to. Returns -1 on failure, after saying
+// why on stderr.
+int ubf__batch_open_output(ubf__batch_state_t *state, size_t job) {
+  const ubf_batch_t *batch = state->batch;
+  const char *input = batch->inputs[job];
+  if (batch->output == UBF_BATCH_ORDERED) {
+    FILE *output = tmpfile();
+    state->jobs[job].output = output;
+    if (output == NULL) {
+      fprintf(stderr, "%s: can't buffer output: %s\n", input,
+              strerror(errno));
+      return -1;
+    }
+    return fileno(output);
+  }
+
+  const char *name = strrchr(input, '/');
+  name = (name != NULL) ? name + 1 : input;
+  size_t length = strlen(batch->output_dir) + strlen(name) + 6;
+  char *path = (char *)malloc(length);
+  if (path == NULL) {
+    fprintf(stderr, "%s: out of memory\n", input);
+    return -1;
+  }
+  snprintf(path, length, "%s/%s.out", batch->output_dir, name);
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) perror(path);
+  free(path);
+  return fd;
+}
+
+void ubf__batch_run_job(ubf__batch_state_t *state, ubf_vm_t *vm, size_t job) {
+  const ubf_batch_t *batch = state->batch;
+  int input = open(batch->inputs[job], O_RDONLY);
+  if (input < 0) perror(batch->inputs[job]);
+  int output = (input >= 0) ? ubf__batch_open_output(state, job) : -1;
+
+  if (input >= 0 && output >= 0) {
+    struct stat st;
+    if (fstat(input, &st) == 0 && S_ISREG(st.st_mode)) {
+      atomic_fetch_add_explicit(&state->input_bytes, st.st_size,
+                                memory_order_relaxed);
+    }
+    vm->config.input_fd = input;
+    vm->config.output_fd = output;
+    if (ubf_execute(vm, state->program) != UBF_OK) {
+      atomic_fetch_add_explicit(&state->failed, 1, memory_order_relaxed);
+    }
+    // resetting flushes the output and lets go of the input, so it has to
+    // happen before either file is closed
+    ubf_reset_vm(vm);
+    off_t written = lseek(output, 0, SEEK_CUR);
+    if (written > 0) {
+      atomic_fetch_add_explicit(&state->output_bytes, written,
+                                memory_order_relaxed);
+    }
+  } else {
+    atomic_fetch_add_explicit(&state->failed, 1, memory_order_relaxed);
+  }
+
+  if (input >= 0) close(input);
+  // ordered output is closed once it's been copied out
+  if (output >= 0 && batch->output == UBF_BATCH_FILES) close(output);
+}
+
+void *ubf__batch_worker(void *arg) {
+  ubf__batch_worker_t *worker = (ubf__batch_worker_t *) arg;
+  ubf__batch_state_t *state = worker->state;
+
+  // the VM, and with it the tape and I/O buffers, is reused for every job the
+  // worker runs. A worker without one still takes its jobs, and fails them,
+  // so ordered output doesn't wait for them forever
+  ubf_vm_t *vm = ubf_init_vm();
+  if (vm != NULL) {
+    vm->config.engine = state->batch->engine;
+    vm->config.eof = state->batch->eof;
+    vm->config.cell_width = state->batch->cell_width;
+    vm->config.overflow = state->batch->overflow;
+    vm->config.fuel = state->batch->fuel;
+    vm->config.max_tape = state->batch->max_tape;
+    vm->config.max_output = state->batch->max_output;
+    vm->config.flush = UBF_FLUSH_ON_EXIT;
+  }
+
+  size_t job;
+  while (ubf__batch_take(state, worker->index, &job)) {
+    if (vm != NULL) {
+      ubf__batch_run_job(state, vm, job);
+    } else {
+      fprintf(stderr, "%s: out of memory\n", state->batch->inputs[job]);
+      atomic_fetch_add_explicit(&state->failed, 1, memory_order_relaxed);
+    }
+    if (state->batch->output == UBF_BATCH_ORDERED) {
+      ubf__batch_finish(state, job);
+    }
+  }
+
+  if (vm != NULL) ubf_free_vm(vm);
+  return NULL;
+}
+
+bool ubf_run_batch(ubf_program_t *program, const ubf_batch_t *batch,
+                   ubf_batch_stats_t *stats) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  unsigned threads = batch->threads;
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? (unsigned) cpus : 1;
+  }
+  if (threads > batch->count) threads = (unsigned) batch->count;
+  if (threads == 0) threads = 1;
+
+  ubf__batch_state_t state;
+  state.program = program;
+  state.batch = batch;
+  state.threads = threads;
+  state.queues =
+    (ubf__batch_queue_t *)malloc(threads * sizeof(ubf__batch_queue_t));
+  state.jobs =
+    (ubf__batch_job_t *)calloc(batch->count + 1, sizeof(ubf__batch_job_t));
+  state.copy_buffer = (batch->output == UBF_BATCH_ORDERED)
+                    ? (uint8_t *)malloc(UBF_OUTPUT_BUFFER_SIZE) : NULL;
+  ubf__batch_worker_t *workers =
+    (ubf__batch_worker_t *)malloc(threads * sizeof(ubf__batch_worker_t));
+  if (state.queues == NULL || state.jobs == NULL || workers == NULL
+      || (batch->output == UBF_BATCH_ORDERED && state.copy_buffer == NULL)) {
+    free(state.queues);
+    free(state.jobs);
+    free(state.copy_buffer);
+    free(workers);
+    if (stats != NULL) {
+      memset(stats, 0, sizeof(ubf_batch_stats_t));
+      stats->jobs = batch->count;
+      stats->failed = batch->count;
+    }
+    return false;
+  }
+  pthread_mutex_init(&state.output_lock, NULL);
+  pthread_cond_init(&state.output_done, NULL);
+  state.next_job = 0;
+  state.next_output = 0;
+  state.writing = false;
+  atomic_init(&state.failed, 0);
+  atomic_init(&state.input_bytes, 0);
+  atomic_init(&state.output_bytes, 0);
+
+  // for output to files, every worker starts out with a contiguous slice of
+  // the inputs
+  for (unsigned i = 0; i < threads; i++) {
+    pthread_mutex_init(&state.queues[i].lock, NULL);
+    state.queues[i].head = batch->count * i / threads;
+    state.queues[i].tail = batch->count * (i + 1) / threads;
+  }
+
+  unsigned started = 0;
+  for (unsigned i = 0; i < threads; i++) {
+    workers[i].state = &state;
+    workers[i].index = i;
+    if (pthread_create(&workers[i].thread, NULL, ubf__batch_worker,
+                       &workers[i]) != 0) {
+      break;
+    }
+    started++;
+  }
+  // if no thread could be started, the jobs are run on this one; otherwise
+  // the threads that did start steal the jobs of the ones that didn't
+  if (started == 0) {
+    ubf__batch_worker(&workers[0]);
+  }
+  for (unsigned i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  size_t failed = atomic_load(&state.failed);
+  if (stats != NULL) {
+    stats->jobs = batch->count;
+    stats->failed = failed;
+    stats->input_bytes = atomic_load(&state.input_bytes);
+    stats->output_bytes = atomic_load(&state.output_bytes);
+    stats->seconds = (end.tv_sec - start.tv_sec)
+                   + (end.tv_nsec - start.tv_nsec) / 1e9;
+  }
+
+  for (unsigned i = 0; i < threads; i++) {
+    pthread_mutex_destroy(&state.queues[i].lock);
+  }
+  pthread_cond_destroy(&state.output_done);
+  pthread_mutex_destroy(&state.output_lock);
+  free(workers);
+  free(state.jobs);
+  free(state.queues);
+  free(state.copy_buffer);
+
+  return failed == 0;
+}
+
+#endif
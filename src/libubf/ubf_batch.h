@@ -0,0 +1,82 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_batch_h
+#define ubf_batch_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ubf_brainfuck.h"
+
+/// Where the output of a batch's jobs goes.
+typedef enum {
+  // every job's output is written to a single file descriptor, whole, in the
+  // order the inputs were given in
+  UBF_BATCH_ORDERED,
+  // every job writes to its own file, named after the job's input
+  UBF_BATCH_FILES
+} ubf_batch_output;
+
+/// A batch of jobs, each running the same program on a different input file.
+typedef struct {
+  // paths to the input files, one job per input
+  const char **inputs;
+  size_t count;
+  // the amount of worker threads, 0 for one per online CPU
+  unsigned threads;
+  // the config the workers' VMs are created with
+  ubf_engine engine;
+  ubf_eof_behavior eof;
+  ubf_cell_width cell_width;
+  ubf_overflow_behavior overflow;
+  // limits for every job, see ubf_vm_config_t
+  uint64_t fuel;
+  size_t max_tape;
+  size_t max_output;
+  ubf_batch_output output;
+  // UBF_BATCH_ORDERED: where the output goes, and whether each job's output
+  // is preceded by a "==> input <==" line, so the stream can be split again
+  int output_fd;
+  bool headers;
+  // UBF_BATCH_FILES: the output for input "path/name" goes to
+  // "output_dir/name.out"
+  const char *output_dir;
+} ubf_batch_t;
+
+/// Aggregate statistics of a finished batch.
+typedef struct {
+  size_t jobs;
+  // jobs whose input or output file couldn't be opened, or that were
+  // stopped by a limit
+  size_t failed;
+  uint64_t input_bytes;
+  uint64_t output_bytes;
+  // wall-clock time
+  double seconds;
+} ubf_batch_stats_t;
+
+/// Initializes a batch with the default settings: no inputs, one thread per
+/// CPU, the interpreter, and ordered output to stdout.
+void ubf_init_batch(ubf_batch_t *batch);
+
+/// Runs every job in a batch, and waits for all of them to finish.
+/// Jobs are spread over a pool of worker threads, each with a VM of its own
+/// that's reset between jobs. With ordered output, jobs are started in the
+/// order of the inputs, and at most UBF_BATCH_MAX_PENDING of them can finish
+/// ahead of an earlier one that's still running. There's no work stealing
+/// then: every worker takes the next job in line from a single shared queue,
+/// which balances the load just as well, but means one slow job holds up the
+/// jobs past that window. With output to files, every worker starts with a
+/// slice of the inputs, and a worker that runs out of jobs steals them from
+/// the others. Inputs and outputs that can't be opened are named on stderr,
+/// and their jobs count as failed. `stats` may be NULL.
+/// Returns false if any job failed, or if there's no memory for the batch.
+bool ubf_run_batch(ubf_program_t *program, const ubf_batch_t *batch,
+                   ubf_batch_stats_t *stats);
+
+#endif
@@ -7,178 +7,319 @@
 #ifndef ubf_c
 #define ubf_c
 
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
-#include <termios.h>
 #include <unistd.h>
 
 #include "ubf_brainfuck.h"
 #include "ubf_compiler.h"
 #include "ubf_debug.h"
+#include "ubf_fusion.h"
+#include "ubf_io.h"
+#include "ubf_jit.h"
+#include "ubf_program.h"
+#include "ubf_tape.h"
+#include "ubf_threaded.h"
 
-ubf_cell_t *ubf__init_cell(void) {
-  ubf_cell_t *cell = (ubf_cell_t *)malloc(sizeof(ubf_cell_t));
-  cell->value = 0;
-  cell->left = NULL;
-  cell->right = NULL;
-  return cell;
-}
-
-void ubf__free_cell(ubf_cell_t *cell) {
-  ubf_cell_t *left = cell->left;
-  ubf_cell_t *right = cell->right;
-  free(cell);
-  if (left != NULL) {
-    left->right = NULL;
-    ubf__free_cell(left);
-  }
-  if (right != NULL) {
-    right->left = NULL;
-    ubf__free_cell(right);
+void ubf_init_config(ubf_vm_config_t *config) {
+  config->engine = UBF_ENGINE_INTERPRETER;
+  config->write_proc = NULL;
+  config->read_proc = NULL;
+  config->io_context = NULL;
+  config->output_fd = STDOUT_FILENO;
+  config->flush = UBF_FLUSH_ON_INPUT | UBF_FLUSH_ON_EXIT;
+  if (isatty(config->output_fd)) {
+    config->flush |= UBF_FLUSH_ON_NEWLINE;
   }
+  config->input_fd = STDIN_FILENO;
+  config->eof = UBF_EOF_MINUS_ONE;
+  config->cell_width = UBF_CELL_8;
+  config->overflow = UBF_OVERFLOW_WRAP;
+  config->fuel = 0;
+  config->max_tape = 0;
+  config->max_output = 0;
+  config->slice = 0;
 }
 
 ubf_vm_t *ubf_init_vm(void) {
-  ubf_vm_t *vm = (ubf_vm_t *)malloc(sizeof(ubf_vm_t));
+  return ubf_init_vm_with_allocator(&ubf_libc_allocator);
+}
+
+ubf_vm_t *ubf_init_vm_with_allocator(const ubf_allocator_t *allocator) {
+  ubf_vm_t *vm = (ubf_vm_t *)ubf__allocate(allocator, sizeof(ubf_vm_t));
+  if (vm == NULL) return NULL;
+  vm->allocator = *allocator;
+  ubf_init_arena(&vm->arena, allocator);
+  ubf_init_arena(&vm->scratch, allocator);
+  ubf_init_config(&vm->config);
   vm->pc = 0;
-  vm->pos = 0;
-  vm->ptr = ubf__init_cell();
+  vm->fuel = UINT64_MAX;
+  vm->output_budget = SIZE_MAX;
+  vm->trap = NULL;
+  vm->nonblocking = false;
+  vm->suspended = false;
+  vm->halt = UBF_OK;
+  // both are set up even if the other one fails, so the VM can be freed
+  bool tape = ubf__init_tape(&vm->tape, &vm->allocator);
+  bool io = ubf__init_io(vm);
+  if (!tape || !io) {
+    ubf_free_vm(vm);
+    return NULL;
+  }
+  vm->ptr = &vm->tape.cells[vm->tape.origin];
   return vm;
 }
 
+void ubf_reset_vm(ubf_vm_t *vm) {
+  ubf_flush(vm);
+  ubf__reset_input(vm);
+  ubf__clear_tape(&vm->tape);
+  vm->pc = 0;
+  vm->output_pending = 0;
+  vm->suspended = false;
+  vm->halt = UBF_OK;
+  vm->ptr = &vm->tape.cells[vm->tape.origin * vm->tape.cell_size];
+}
+
 void ubf_free_vm(ubf_vm_t *vm) {
-  ubf__free_cell(vm->ptr);
-  free(vm);
+  // the I/O state has to be let go of properly, but the memory goes back all
+  // at once, with the arenas
+  ubf__free_io(vm);
+  ubf__free_tape(&vm->tape);
+  ubf_free_arena(&vm->arena);
+  ubf_free_arena(&vm->scratch);
+  ubf_allocator_t allocator = vm->allocator;
+  ubf__deallocate(&allocator, vm, sizeof(ubf_vm_t));
 }
 
-char ubf__getch(void) {
-  struct termios old, new;
-  int ch;
+// The execution loop is instantiated for every cell width, with wrapping and
+// saturating cells (see ubf_interpreter_impl.h).
+#define UBF_INTERP_NAME ubf__interpret_8
+#define UBF_INTERP_CELL uint8_t
+#define UBF_INTERP_SATURATE 0
+#include "ubf_interpreter_impl.h"
 
-  tcgetattr(STDIN_FILENO, &old);
-  new = old;
-  new.c_lflag &= ~(ICANON | ECHO);
+#define UBF_INTERP_NAME ubf__interpret_16
+#define UBF_INTERP_CELL uint16_t
+#define UBF_INTERP_SATURATE 0
+#include "ubf_interpreter_impl.h"
 
-  tcsetattr(STDIN_FILENO, TCSANOW, &new);
-  ch = getchar();
+#define UBF_INTERP_NAME ubf__interpret_32
+#define UBF_INTERP_CELL uint32_t
+#define UBF_INTERP_SATURATE 0
+#include "ubf_interpreter_impl.h"
 
-  tcsetattr(STDIN_FILENO, TCSANOW, &old);
+#define UBF_INTERP_NAME ubf__interpret_64
+#define UBF_INTERP_CELL uint64_t
+#define UBF_INTERP_SATURATE 0
+#include "ubf_interpreter_impl.h"
 
-  return ch;
-}
+#define UBF_INTERP_NAME ubf__interpret_8_saturating
+#define UBF_INTERP_CELL uint8_t
+#define UBF_INTERP_SATURATE 1
+#include "ubf_interpreter_impl.h"
+
+#define UBF_INTERP_NAME ubf__interpret_16_saturating
+#define UBF_INTERP_CELL uint16_t
+#define UBF_INTERP_SATURATE 1
+#include "ubf_interpreter_impl.h"
+
+#define UBF_INTERP_NAME ubf__interpret_32_saturating
+#define UBF_INTERP_CELL uint32_t
+#define UBF_INTERP_SATURATE 1
+#include "ubf_interpreter_impl.h"
+
+#define UBF_INTERP_NAME ubf__interpret_64_saturating
+#define UBF_INTERP_CELL uint64_t
+#define UBF_INTERP_SATURATE 1
+#include "ubf_interpreter_impl.h"
+
+typedef ubf_interpret_result (*ubf__interpret_fn)(ubf_vm_t *vm,
+                                                  ubf_chunk_t *chunk);
 
+// Runs a chunk in the execution loop instantiated for the VM's cells.
 ubf_interpret_result ubf__interpret_impl(ubf_vm_t *vm, ubf_chunk_t *chunk) {
-  // microbf uses computed gotos for code execution.
-  // You can read more on that here:
-  // https://eli.thegreenplace.net/2012/07/12/computed-goto-for-efficient-dispatch-tables
-  #define READ() chunk->bytecode[vm->pc++]
-  #ifdef UBF_VM_USE_COMPUTED_GOTO
-  # define DISPATCH() goto *dispatch_table[READ()]
-  static void *dispatch_table[] = {
-    &&_UBF_INC, &&_UBF_DEC,
-    &&_UBF_LT,  &&_UBF_RT,
-    &&_UBF_JZ,  &&_UBF_JNZ,
-    &&_UBF_PUT, &&_UBF_GET,
-    &&_UBF_FIN
+  static const ubf__interpret_fn loops[2][4] = {
+    { ubf__interpret_8, ubf__interpret_16,
+      ubf__interpret_32, ubf__interpret_64 },
+    { ubf__interpret_8_saturating, ubf__interpret_16_saturating,
+      ubf__interpret_32_saturating, ubf__interpret_64_saturating }
   };
-  # define CASE(e) _##e:
-  #else
-  # define DISPATCH() break
-  # define CASE(e) case e:
-  #endif
+  size_t width;
+  switch (vm->tape.cell_size) {
+    case 2: width = 1; break;
+    case 4: width = 2; break;
+    case 8: width = 3; break;
+    default: width = 0; break;
+  }
+  bool saturate = vm->config.overflow == UBF_OVERFLOW_SATURATE;
+  return loops[saturate][width](vm, chunk);
+}
 
+ubf_interpret_result ubf_interpret(ubf_vm_t *vm, const char *code) {
+  return ubf_interpret_buffer(vm, code, strlen(code));
+}
+
+ubf_interpret_result ubf_interpret_buffer(ubf_vm_t *vm, const char *code,
+                                          size_t length) {
+  // the program only lives for this one run, so it's compiled into the VM's
+  // scratch arena, and thrown away with a single reset
+  ubf_program_t *program =
+    ubf_compile_program_with_allocator(code, length, &vm->scratch.allocator);
+  ubf_interpret_result result = UBF_COMPILE_ERROR;
+  if (program != NULL) {
+    result = ubf_execute(vm, program);
+    ubf_release_program(program);
+  }
+  ubf_reset_arena(&vm->scratch);
+  return result;
+}
+
+// Runs a program with the engine from the VM's config.
+ubf_interpret_result ubf__run(ubf_vm_t *vm, void *code) {
+  ubf_program_t *program = (ubf_program_t *) code;
+  ubf_jit_code_t *jit = NULL;
+  ubf_threaded_code_t *threaded = NULL;
+  ubf__set_cell_size(vm, ubf__cell_size(vm->config.cell_width));
+  // the other engines only know about 8-bit wrapping cells
+  ubf_engine engine = vm->config.engine;
+  if (vm->tape.cell_size != sizeof(ubf_cell_t)
+      || vm->config.overflow != UBF_OVERFLOW_WRAP) {
+    engine = UBF_ENGINE_INTERPRETER;
+  }
+  switch (engine) {
+    case UBF_ENGINE_INTERPRETER:
+      break;
+    case UBF_ENGINE_TAIL_CALL:
+      threaded = ubf__program_threaded(program, UBF_ENGINE_TAIL_CALL);
+      if (threaded != NULL) break;
+      // fall through
+    case UBF_ENGINE_DIRECT_THREADED:
+      threaded = ubf__program_threaded(program, UBF_ENGINE_DIRECT_THREADED);
+      break;
+    case UBF_ENGINE_JIT:
+      jit = ubf__program_jit(program);
+      break;
+  }
+  if (jit != NULL) {
+    return ubf__jit_run(vm, jit);
+  } else if (threaded != NULL) {
+    return ubf__threaded_run(vm, threaded);
+  }
+  return ubf__interpret_impl(vm, program->chunk);
+}
+
+// Sets a VM up to run a program from the start, with the full limits.
+void ubf__start(ubf_vm_t *vm) {
   vm->pc = 0;
+  vm->fuel = (vm->config.fuel != 0) ? vm->config.fuel : UINT64_MAX;
+  vm->output_budget = (vm->config.max_output != 0) ? vm->config.max_output
+                                                   : SIZE_MAX;
+  vm->halt = UBF_OK;
+}
 
-  #ifdef UBF_VM_USE_COMPUTED_GOTO
-  DISPATCH();
-  while (true) {
-  #else
-  while (true) {
-    switch (READ()) {
-  #endif
-      CASE(UBF_INC) {
-        vm->ptr->value += READ();
-        DISPATCH();
-      }
-      CASE(UBF_DEC) {
-        vm->ptr->value -= READ();
-        DISPATCH();
-      }
-      CASE(UBF_LT) {
-        uint8_t amt = READ();
-        for (uint8_t i = 0; i < amt; i++) {
-          if (vm->ptr->left == NULL) {
-            vm->ptr->left = ubf__init_cell();
-            vm->ptr->left->value = 0;
-            vm->ptr->left->right = vm->ptr;
-          }
-          vm->ptr = vm->ptr->left;
-        }
-        vm->pos -= amt;
-        DISPATCH();
-      }
-      CASE(UBF_RT) {
-        uint8_t amt = READ();
-        for (uint8_t i = 0; i < amt; i++) {
-          if (vm->ptr->right == NULL) {
-            vm->ptr->right = ubf__init_cell();
-            vm->ptr->right->value = 0;
-            vm->ptr->right->left = vm->ptr;
-          }
-          vm->ptr = vm->ptr->right;
-        }
-        vm->pos += amt;
-        DISPATCH();
-      }
-      CASE(UBF_JZ) {
-        uint8_t addr = chunk->offset_table[READ()];
-        if (vm->ptr->value == 0) {
-          vm->pc = addr;
-        }
-        DISPATCH();
-      }
-      CASE(UBF_JNZ) {
-        uint8_t addr = chunk->offset_table[READ()];
-        if (vm->ptr->value != 0) {
-          vm->pc = addr;
-        }
-        DISPATCH();
-      }
-      CASE(UBF_PUT) {
-        uint8_t amt = READ();
-        for (uint8_t i = 0; i < amt; i++) {
-          printf("%c", vm->ptr->value);
-        }
-        DISPATCH();
-      }
-      CASE(UBF_GET) {
-        uint8_t amt = READ();
-        for (uint8_t i = 0; i < amt; i++) {
-          vm->ptr->value = ubf__getch();
-        }
-        DISPATCH();
-      }
-      CASE(UBF_FIN) {
-        return UBF_OK;
-      }
-    }
-  #ifndef UBF_VM_USE_COMPUTED_GOTO
+// Runs code from where it stopped. Fuel is checked by the engines
+// themselves, but the tape and output limits are hit deep inside calls out of
+// them, and so is running out of memory, so those jump straight back here.
+ubf_interpret_result ubf__run_trapped(ubf_vm_t *vm, ubf__run_fn run,
+                                      void *code) {
+  if (vm->config.max_tape != 0
+      && vm->config.max_tape < UBF_TAPE_MIN_LENGTH) {
+    return UBF_TAPE_LIMIT;
+  }
+
+  jmp_buf trap;
+  ubf_interpret_result result;
+  switch (setjmp(trap)) {
+    case 0:
+      vm->trap = &trap;
+      result = run(vm, code);
+      break;
+    case UBF_TAPE_LIMIT:
+      result = UBF_TAPE_LIMIT;
+      break;
+    case UBF_OUT_OF_MEMORY:
+      result = UBF_OUT_OF_MEMORY;
+      break;
+    default:
+      result = UBF_OUTPUT_LIMIT;
+      break;
   }
-  #endif
+  vm->trap = NULL;
+  if (result == UBF_TAPE_LIMIT || result == UBF_OUTPUT_LIMIT
+      || result == UBF_OUT_OF_MEMORY) {
+    // the engine's pointer was lost along with its frame
+    vm->ptr = &vm->tape.cells[vm->tape.origin * vm->tape.cell_size];
+  }
+  return result;
+}
 
-  #undef READ
-  #undef DISPATCH
-  #undef CASE
+ubf_interpret_result ubf__execute_with(ubf_vm_t *vm, ubf__run_fn run,
+                                       void *code) {
+  ubf__start(vm);
+  vm->nonblocking = false;
+  vm->suspended = false;
+  vm->output_pending = 0;
+  ubf_interpret_result result = ubf__run_trapped(vm, run, code);
+  if (vm->config.flush & UBF_FLUSH_ON_EXIT) {
+    ubf_flush(vm);
+  }
+  return result;
 }
 
-ubf_interpret_result ubf_interpret(ubf_vm_t *vm, const char *code) {
-  ubf_chunk_t *chunk = ubf__alloc_chunk(0);
-  ubf_compile(code, strlen(code), chunk);
+ubf_interpret_result ubf_execute(ubf_vm_t *vm, ubf_program_t *program) {
+  return ubf__execute_with(vm, ubf__run, program);
+}
 
-  ubf_interpret_result result = ubf__interpret_impl(vm, chunk);
+ubf_interpret_result ubf_resume(ubf_vm_t *vm, ubf_program_t *program) {
+  if (!vm->suspended) {
+    ubf__start(vm);
+    vm->output_pending = 0;
+  }
+  vm->halt = UBF_OK;
+  vm->suspended = true;
+
+  // output that didn't fit last time goes first, the program can't carry on
+  // until all of it's buffered
+  if (vm->output_pending != 0) {
+    ubf_buffer_t *out = &vm->output;
+    size_t space = out->capacity - out->length;
+    size_t n = (vm->output_pending < space) ? vm->output_pending : space;
+    memset(&out->data[out->length], vm->output_pending_byte, n);
+    out->length += n;
+    vm->output_pending -= n;
+    if (vm->output_pending != 0) return UBF_OUTPUT_READY;
+  }
 
-  ubf__free_chunk(chunk);
+  // a slice is run as if it was all the fuel there is, and whatever it used
+  // is taken off the real fuel afterwards
+  uint64_t total = vm->fuel;
+  uint64_t slice = (vm->config.slice != 0 && vm->config.slice < total)
+                 ? vm->config.slice : total;
+  vm->fuel = slice;
+  vm->nonblocking = true;
+  ubf_interpret_result result = ubf__run_trapped(vm, ubf__run, program);
+  vm->nonblocking = false;
+  vm->fuel = total - (slice - vm->fuel);
+
+  switch (result) {
+    case UBF_OUT_OF_FUEL:
+      if (slice < total) {
+        result = UBF_YIELD;
+      } else {
+        vm->suspended = false;
+      }
+      break;
+    case UBF_NEEDS_INPUT:
+    case UBF_OUTPUT_READY:
+      break;
+    default:
+      // finished, or stopped by a limit: the next call starts over
+      vm->suspended = false;
+      break;
+  }
   return result;
 }
 
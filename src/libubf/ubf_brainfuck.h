@@ -7,32 +7,207 @@
 #ifndef ubf_h
 #define ubf_h
 
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "ubf_alloc.h"
 #include "ubf_options.h"
 
-/// A single memory cell.
-/// microbf implements memory as a linked list, so theoretically an infinite
-/// amount of cells is possible (in the real world, it's limited by
+/// An 8-bit memory cell, the default width, and the only one the threaded
+/// engines and the JIT work with.
+typedef uint8_t ubf_cell_t;
+
+/// The tape.
+/// microbf implements memory as a contiguous array of cells, which is grown
+/// in both directions as the program moves past either end, so theoretically
+/// an infinite amount of cells is possible (in the real world, it's limited by
 /// the host's memory).
-typedef struct cell_ {
-  UBF_MEM_TYPE value;
-  struct cell_ *left;
-  struct cell_ *right;
-} ubf_cell_t;
+typedef struct {
+  // the cells, `cell_size` bytes each
+  uint8_t *cells;
+  // the amount of cells
+  size_t length;
+  // index of the cell the program started at
+  size_t origin;
+  size_t cell_size;
+  // where the cells are allocated from
+  const ubf_allocator_t *allocator;
+} ubf_tape_t;
+
+/// Takes `length` bytes of a program's output, and returns how many of them
+/// it took. Taking fewer means the destination can't take more right now:
+/// ubf_resume stops the program until a later ubf_flush gets the rest out, and
+/// ubf_execute keeps offering the rest until it's taken. Output that can't be
+/// written at all should be reported as taken, and dropped.
+typedef size_t (*ubf_write_proc)(void *context, const uint8_t *data,
+                                 size_t length);
+
+/// Returned by a ubf_read_proc when there's no input yet.
+#define UBF_WOULD_BLOCK (-1)
+
+/// Reads up to `capacity` bytes of a program's input into `buffer`, and
+/// returns how many it read, 0 at the end of input, or UBF_WOULD_BLOCK if
+/// there's no input yet. ubf_resume stops the program until there is, and
+/// ubf_execute treats it as the end of input.
+typedef ptrdiff_t (*ubf_read_proc)(void *context, uint8_t *buffer,
+                                   size_t capacity);
+
+/// The engine a VM executes code with.
+typedef enum {
+  // the bytecode interpreter
+  UBF_ENGINE_INTERPRETER,
+  // translates bytecode to a stream of handler addresses, so dispatching an
+  // instruction is a single indirect jump (needs computed gotos, falls back to
+  // the interpreter otherwise)
+  UBF_ENGINE_DIRECT_THREADED,
+  // like the direct-threaded engine, but every handler is a function that
+  // tail-calls the next one, which keeps the VM's state in registers (falls
+  // back to the direct-threaded engine where tail calls aren't guaranteed)
+  UBF_ENGINE_TAIL_CALL,
+  // compiles bytecode to native code before running it (x86-64 only, falls
+  // back to the interpreter on other platforms)
+  UBF_ENGINE_JIT
+} ubf_engine;
+
+/// Events on which a VM's output buffer is flushed. A full buffer is always
+/// flushed.
+typedef enum {
+  UBF_FLUSH_ON_NEWLINE = 1 << 0,
+  // before the program reads input, so prompts are visible
+  UBF_FLUSH_ON_INPUT = 1 << 1,
+  // when ubf_interpret returns
+  UBF_FLUSH_ON_EXIT = 1 << 2
+} ubf_flush_flags;
 
-typedef void (*ubf_put_proc)(ubf_cell_t *cell);
-typedef void (*ubf_get_proc)(ubf_cell_t *cell);
+/// What happens to a cell when the program reads past the end of its input.
+typedef enum {
+  // the cell is set to -1
+  UBF_EOF_MINUS_ONE,
+  // the cell is set to 0
+  UBF_EOF_ZERO,
+  // the cell keeps its value
+  UBF_EOF_UNCHANGED
+} ubf_eof_behavior;
+
+/// The width of a VM's cells, in bits.
+typedef enum {
+  UBF_CELL_8 = 8,
+  UBF_CELL_16 = 16,
+  UBF_CELL_32 = 32,
+  UBF_CELL_64 = 64
+} ubf_cell_width;
+
+/// What happens to a cell that's incremented past its largest value, or
+/// decremented past zero.
+typedef enum {
+  // the cell wraps around to zero, or to its largest value
+  UBF_OVERFLOW_WRAP,
+  // the cell stays at its largest value, or at zero
+  UBF_OVERFLOW_SATURATE
+} ubf_overflow_behavior;
 
 /// A configuration for a microbf VM.
 typedef struct {
-  ubf_put_proc put_proc;
-  ubf_get_proc get_proc;
+  ubf_engine engine;
+  // callbacks the program's output is written to and its input is read from,
+  // both called with io_context. Output is handed over a buffer at a time,
+  // and input is read a buffer at a time. NULL uses the file descriptors
+  // below instead
+  ubf_write_proc write_proc;
+  ubf_read_proc read_proc;
+  void *io_context;
+  // file descriptor the program's output is written to
+  int output_fd;
+  // a combination of ubf_flush_flags
+  unsigned flush;
+  // file descriptor the program's input is read from
+  int input_fd;
+  ubf_eof_behavior eof;
+  // cells wider than 8 bits, or saturating ones, are only supported by the
+  // interpreter; VMs configured for them fall back to it from other engines.
+  // Changing the width clears the tape the next time the VM runs
+  ubf_cell_width cell_width;
+  ubf_overflow_behavior overflow;
+  // limits for running untrusted programs, 0 meaning no limit. Fuel is
+  // charged every time a loop repeats, by the amount of instructions in its
+  // body, so it roughly counts the instructions executed without costing
+  // anything outside of loops
+  uint64_t fuel;
+  // the most cells the tape may grow to. A tape that's already longer starts
+  // over the next time the VM runs. The tape always has at least
+  // UBF_TAPE_MIN_LENGTH cells, so smaller limits can't be enforced, and are
+  // rejected instead: the program isn't run, and UBF_TAPE_LIMIT is returned
+  // right away
+  size_t max_tape;
+  // the most bytes the program may output
+  size_t max_output;
+  // the fuel ubf_resume runs a program for before it yields, 0 to never
+  // yield
+  uint64_t slice;
 } ubf_vm_config_t;
 
+/// Initializes a config with the defaults every new VM starts out with: the
+/// interpreter, I/O on stdin and stdout, 8-bit wrapping cells, and no limits.
 void ubf_init_config(ubf_vm_config_t *config);
 
+/// A buffer for I/O.
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+} ubf_buffer_t;
+
+struct termios;
+
+/// The VM's input state.
+/// Input is set up lazily, when the program first reads. A regular file is
+/// mapped into memory as a whole, anything else is read through a buffer.
+typedef struct {
+  bool initialized;
+  // the bytes available for reading, pointing into either the buffer or the
+  // mapped file
+  const uint8_t *data;
+  size_t length;
+  size_t position;
+  uint8_t *buffer;
+  size_t capacity;
+  bool mapped;
+  // the terminal's settings from before it was switched to raw mode, NULL if
+  // the input isn't a terminal
+  struct termios *saved_termios;
+  // how many bytes a read interrupted by ubf_resume still has to read when
+  // it's executed again
+  size_t owed;
+} ubf_input_t;
+
+/// The result of an interpreter session.
+typedef enum {
+  // the program finished
+  UBF_OK,
+  // the program ran out of fuel before finishing
+  UBF_OUT_OF_FUEL,
+  // the program tried to grow the tape past config.max_tape cells
+  UBF_TAPE_LIMIT,
+  // the program tried to output more than config.max_output bytes; the
+  // output is cut off at the limit
+  UBF_OUTPUT_LIMIT,
+  // ubf_resume only: the program is waiting for input that isn't there yet
+  UBF_NEEDS_INPUT,
+  // ubf_resume only: the output buffer is full, or is meant to be flushed
+  // according to config.flush
+  UBF_OUTPUT_READY,
+  // ubf_resume only: the program used up config.slice
+  UBF_YIELD,
+  // ubf_interpret only: the code doesn't compile, because its brackets are
+  // unbalanced, or there's no memory for the program
+  UBF_COMPILE_ERROR,
+  // the VM's allocator ran out of memory for the tape or the input buffer
+  UBF_OUT_OF_MEMORY
+} ubf_interpret_result;
+
 /// The microbf virtual machine.
 /// This is the state machine for code execution.
 typedef struct {
@@ -41,22 +216,113 @@ typedef struct {
   // bytecode
   size_t pc;
   // tape
-  int pos;
-  ubf_cell_t *ptr;
+  ubf_tape_t tape;
+  // points to a cell of the tape's width
+  void *ptr;
+  // I/O
+  ubf_buffer_t output;
+  ubf_input_t input;
+  // a run of output that didn't fit in the buffer when ubf_resume stopped,
+  // buffered first thing when it resumes
+  size_t output_pending;
+  uint8_t output_pending_byte;
+  // what's left of the limits in the config
+  uint64_t fuel;
+  size_t output_budget;
+  // where ubf_execute or ubf_resume is waiting for the tape or output limit
+  // to be hit, NULL outside of them
+  jmp_buf *trap;
+  // set while running in ubf_resume, where I/O must not block
+  bool nonblocking;
+  // set when ubf_resume stopped a program that can be resumed
+  bool suspended;
+  // why I/O needs the program to stop, UBF_OK if it doesn't
+  ubf_interpret_result halt;
+  // memory: the allocator the VM was created with, which the tape is
+  // allocated from on its own, an arena holding the I/O buffers for as long
+  // as the VM lives, and one for the programs ubf_interpret compiles, which is
+  // reset after every run
+  ubf_allocator_t allocator;
+  ubf_arena_t arena;
+  ubf_arena_t scratch;
 } ubf_vm_t;
 
-/// The result of an interpreter session.
-typedef enum {
-  UBF_OK
-} ubf_interpret_result;
+/// A compiled brainfuck program.
+/// Programs are immutable and reference counted, so a program compiled once
+/// can be run by any number of VMs, on any number of threads, at the same time.
+typedef struct ubf_program_ ubf_program_t;
+
+/// Compiles `length` bytes of brainfuck code into a program.
+/// The program starts out with a single reference, owned by the caller.
+/// Returns NULL if the code doesn't compile, because its brackets are
+/// unbalanced.
+ubf_program_t *ubf_compile_program(const char *code, size_t length);
+
+/// Compiles a program whose memory comes from `allocator`, eg. an arena that's
+/// reset once the program's been released. That includes the code the engines
+/// translate the program to when it's first run, so the allocator has to
+/// outlive the program, and be safe to use from every thread the program is
+/// run on.
+/// Returns NULL if the code doesn't compile, or the allocator runs out of
+/// memory.
+ubf_program_t *ubf_compile_program_with_allocator(
+    const char *code, size_t length, const ubf_allocator_t *allocator);
+
+/// Adds a reference to a program. Returns the program.
+ubf_program_t *ubf_retain_program(ubf_program_t *program);
+
+/// Drops a reference to a program, freeing it once the last one is gone.
+void ubf_release_program(ubf_program_t *program);
 
 /// Initializes and returns a new VM.
 ubf_vm_t *ubf_init_vm(void);
 
+/// Initializes and returns a new VM, whose memory comes from `allocator`.
+/// Apart from the tape, which is resized as it grows, the VM keeps its memory
+/// in arenas, so it only asks the allocator for a few large blocks, and gives
+/// them all back when it's freed.
+/// Returns NULL if the allocator runs out of memory.
+ubf_vm_t *ubf_init_vm_with_allocator(const ubf_allocator_t *allocator);
+
+/// Resets a VM to the state of a freshly initialized one, keeping its config.
+/// Pending output is flushed, and input is set up again on the next read, so
+/// the config's callbacks and file descriptors may be changed in between. The
+/// VM's memory is all kept for reuse.
+void ubf_reset_vm(ubf_vm_t *vm);
+
 /// Frees a VM.
 void ubf_free_vm(ubf_vm_t *vm);
 
-/// Interprets brainfuck code in a VM.
+/// Runs a compiled program in a VM.
+/// A VM runs one program at a time, but the same program may be run by other
+/// VMs concurrently. Every run starts with the full limits from the config.
+/// When a limit is hit, the program is stopped and the pointer goes back to
+/// the tape's origin.
+ubf_interpret_result ubf_execute(ubf_vm_t *vm, ubf_program_t *program);
+
+/// Runs a program in a VM without ever blocking, so one thread can drive many
+/// VMs. The program runs until it finishes (UBF_OK), hits a limit, reads
+/// input the input file descriptor doesn't have yet (UBF_NEEDS_INPUT), fills
+/// up its output buffer (UBF_OUTPUT_READY), or runs for config.slice
+/// (UBF_YIELD), whichever comes first. The VM keeps its state in between,
+/// and calling ubf_resume again carries on from where the program stopped;
+/// once it finishes or hits a limit, the next call starts it over.
+/// The input file descriptor should be non-blocking. Output is never written
+/// by ubf_resume: call ubf_flush whenever it returns, to make room for more.
+ubf_interpret_result ubf_resume(ubf_vm_t *vm, ubf_program_t *program);
+
+/// Compiles and interprets brainfuck code in a VM.
+/// Use ubf_compile_program and ubf_execute to run the same code repeatedly.
 ubf_interpret_result ubf_interpret(ubf_vm_t *vm, const char *code);
 
+/// Interprets `length` bytes of brainfuck code in a VM. The code doesn't have
+/// to be null-terminated, so it can be eg. a file mapped into memory.
+ubf_interpret_result ubf_interpret_buffer(ubf_vm_t *vm, const char *code,
+                                          size_t length);
+
+/// Writes out any output the VM has buffered.
+/// Returns false if the output file descriptor is non-blocking, and couldn't
+/// take all of it; the rest stays buffered for the next flush.
+bool ubf_flush(ubf_vm_t *vm);
+
 #endif
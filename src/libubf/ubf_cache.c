@@ -0,0 +1,270 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_cache_c
+#define ubf_cache_c
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ubf_cache.h"
+#include "ubf_options.h"
+#include "ubf_program.h"
+
+#define UBF_CACHE_MAGIC "ubfc"
+#define UBF_CACHE_BYTE_ORDER 0x01020304
+
+uint64_t ubf_hash(const void *data, size_t length) {
+  const uint8_t *bytes = (const uint8_t *) data;
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+bool ubf_verify_chunk(const ubf_chunk_t *chunk) {
+  if (chunk->length == 0 || chunk->code[chunk->length - 1].opcode != UBF_FIN) {
+    return false;
+  }
+
+  for (size_t i = 0; i < chunk->length; i++) {
+    const ubf_instr_t *instr = &chunk->code[i];
+    if (instr->offset < -UBF_TAPE_MARGIN || instr->offset > UBF_TAPE_MARGIN) {
+      return false;
+    }
+    if (instr->opcode >= UBF_OPCODE_COUNT) return false;
+    // a superinstruction's handler takes the operands of its other parts from
+    // the instructions following it, which must be exactly those parts (they
+    // are verified on their own in turn)
+    const ubf_opcode_info_t *info = &ubf_opcode_info[instr->opcode];
+    if (i + info->length > chunk->length) return false;
+    for (size_t k = 1; k < info->length; k++) {
+      if (chunk->code[i + k].opcode != info->parts[k]) return false;
+    }
+    ubf_opcode opcode = ubf__base_opcode(instr->opcode);
+    switch (opcode) {
+      case UBF_INC:
+      case UBF_DEC:
+      case UBF_LT:
+      case UBF_RT:
+      case UBF_PUT:
+      case UBF_GET:
+        if (instr->operand < 0) return false;
+        break;
+      case UBF_JZ:
+      case UBF_JNZ: {
+        // jumps are relative to the next instruction, so they land right
+        // after their counterpart, which must jump back by the same amount
+        int64_t other = (int64_t) i + instr->operand;
+        if (other < 0 || other >= (int64_t) chunk->length) return false;
+        const ubf_instr_t *pair = &chunk->code[other];
+        ubf_opcode pair_opcode = ubf__base_opcode(pair->opcode);
+        if (opcode == UBF_JZ
+              ? instr->operand <= 0 || pair_opcode != UBF_JNZ
+              : instr->operand >= 0 || pair_opcode != UBF_JZ) {
+          return false;
+        }
+        if (pair->operand != -instr->operand) return false;
+        break;
+      }
+      case UBF_SCAN:
+        if (instr->operand == 0) return false;
+        break;
+      case UBF_SET:
+      case UBF_MUL:
+      case UBF_FIN:
+        break;
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// Writes the whole buffer, retrying on partial writes.
+bool ubf__cache_write_all(int fd, const void *data, size_t length) {
+  const uint8_t *bytes = (const uint8_t *) data;
+  while (length > 0) {
+    ssize_t written = write(fd, bytes, length);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    bytes += written;
+    length -= written;
+  }
+  return true;
+}
+
+bool ubf_cache_write(const char *path, const ubf_chunk_t *chunk,
+                     const char *source, size_t source_length, int opt_level) {
+  // the instructions are copied field by field, so the padding in them is
+  // zeroed and the file's checksum doesn't depend on whatever was left there
+  size_t size = chunk->length * sizeof(ubf_instr_t);
+  ubf_instr_t *code =
+    (ubf_instr_t *) calloc(chunk->length, sizeof(ubf_instr_t));
+  if (code == NULL) return false;
+  for (size_t i = 0; i < chunk->length; i++) {
+    code[i].opcode = chunk->code[i].opcode;
+    code[i].operand = chunk->code[i].operand;
+    code[i].offset = chunk->code[i].offset;
+  }
+
+  ubf_cache_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, UBF_CACHE_MAGIC, sizeof(header.magic));
+  header.version = UBF_CACHE_VERSION;
+  header.instr_size = sizeof(ubf_instr_t);
+  header.byte_order = UBF_CACHE_BYTE_ORDER;
+  header.opcode_count = UBF_OPCODE_COUNT;
+  header.opt_level = (uint32_t) opt_level;
+  header.length = chunk->length;
+  header.source_length = source_length;
+  header.checksum = ubf_hash(code, size);
+
+  // written next to the destination and renamed over it, so the file appears
+  // all at once
+  size_t tmp_length = strlen(path) + 32;
+  char *tmp_path = (char *) malloc(tmp_length);
+  snprintf(tmp_path, tmp_length, "%s.%ld.tmp", path, (long) getpid());
+
+  bool ok = false;
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    ok = ubf__cache_write_all(fd, &header, sizeof(header))
+      && ubf__cache_write_all(fd, code, size)
+      && ubf__cache_write_all(fd, source, source_length);
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if (!ok) unlink(tmp_path);
+  }
+
+  free(tmp_path);
+  free(code);
+  return ok;
+}
+
+ubf_cache_result ubf__cache_check(const uint8_t *data, size_t size,
+                                  const char *source, size_t source_length,
+                                  int opt_level, ubf_chunk_t *chunk) {
+  const ubf_cache_header_t *header = (const ubf_cache_header_t *) data;
+  if (size < sizeof(ubf_cache_header_t)
+      || memcmp(header->magic, UBF_CACHE_MAGIC, sizeof(header->magic)) != 0
+      || header->version != UBF_CACHE_VERSION
+      || header->instr_size != sizeof(ubf_instr_t)
+      || header->byte_order != UBF_CACHE_BYTE_ORDER
+      || header->opcode_count != UBF_OPCODE_COUNT) {
+    return UBF_CACHE_BAD_FORMAT;
+  }
+  if (header->source_length != source_length
+      || header->opt_level != (uint32_t) opt_level) {
+    return UBF_CACHE_STALE;
+  }
+
+  size_t rest = size - sizeof(ubf_cache_header_t);
+  if (source_length > rest
+      || header->length != (rest - source_length) / sizeof(ubf_instr_t)
+      || (rest - source_length) % sizeof(ubf_instr_t) != 0) {
+    return UBF_CACHE_CORRUPT;
+  }
+  size_t code_size = rest - source_length;
+  const uint8_t *code = data + sizeof(ubf_cache_header_t);
+  if (memcmp(code + code_size, source, source_length) != 0) {
+    return UBF_CACHE_STALE;
+  }
+  if (ubf_hash(code, code_size) != header->checksum) {
+    return UBF_CACHE_CORRUPT;
+  }
+
+  // the mapping is read-only, none of the engines write to the code
+  chunk->code = (ubf_instr_t *) code;
+  chunk->length = header->length;
+  chunk->capacity = header->length;
+  chunk->map = NULL;
+  chunk->allocator = NULL;
+  if (!ubf_verify_chunk(chunk)) {
+    return UBF_CACHE_CORRUPT;
+  }
+  return UBF_CACHE_OK;
+}
+
+ubf_cache_result ubf_cache_load(const char *path, const char *source,
+                                size_t source_length, int opt_level,
+                                ubf_cached_chunk_t *cached) {
+  cached->mapping = NULL;
+  cached->size = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return UBF_CACHE_IO_ERROR;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return UBF_CACHE_IO_ERROR;
+  }
+  if ((size_t) st.st_size < sizeof(ubf_cache_header_t)) {
+    close(fd);
+    return UBF_CACHE_BAD_FORMAT;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return UBF_CACHE_IO_ERROR;
+
+  ubf_cache_result result =
+    ubf__cache_check((const uint8_t *) data, st.st_size, source,
+                     source_length, opt_level, &cached->chunk);
+  if (result != UBF_CACHE_OK) {
+    munmap(data, st.st_size);
+    return result;
+  }
+  cached->mapping = data;
+  cached->size = st.st_size;
+  return UBF_CACHE_OK;
+}
+
+void ubf_cache_unload(ubf_cached_chunk_t *cached) {
+  if (cached->mapping != NULL) {
+    munmap(cached->mapping, cached->size);
+    cached->mapping = NULL;
+  }
+}
+
+bool ubf_cache_write_program(const char *path, const ubf_program_t *program,
+                             const char *source, size_t source_length) {
+  return ubf_cache_write(path, program->chunk, source, source_length,
+                         program->opt_level);
+}
+
+ubf_program_t *ubf_cache_load_program(const char *path, const char *source,
+                                      size_t source_length, int opt_level,
+                                      ubf_cache_result *result) {
+  ubf_program_t *program = ubf__alloc_program(&ubf_libc_allocator);
+  if (program == NULL) {
+    *result = UBF_CACHE_IO_ERROR;
+    return NULL;
+  }
+  program->opt_level = opt_level;
+  *result = ubf_cache_load(path, source, source_length, opt_level,
+                           &program->cached);
+  if (*result != UBF_CACHE_OK) {
+    ubf__deallocate(program->allocator, program, sizeof(ubf_program_t));
+    return NULL;
+  }
+  program->chunk = &program->cached.chunk;
+  return program;
+}
+
+#endif
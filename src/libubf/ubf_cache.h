@@ -0,0 +1,110 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_cache_h
+#define ubf_cache_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ubf_brainfuck.h"
+#include "ubf_compiler.h"
+
+/// The version of the cache file format.
+/// Bump this whenever the meaning of the bytecode changes, eg. when an opcode
+/// is added, so that stale files are recompiled instead of misinterpreted.
+#define UBF_CACHE_VERSION 4
+
+/// The header of a cache file.
+/// The header is followed by the chunk's instructions, stored exactly as they
+/// are laid out in memory, so a mapped file can be run without copying it, and
+/// then by the source code they were compiled from.
+typedef struct {
+  // "ubfc"
+  char magic[4];
+  uint32_t version;
+  // checked to reject files written on hosts with a different instruction
+  // layout or byte order
+  uint32_t instr_size;
+  uint32_t byte_order;
+  uint32_t opcode_count;
+  uint32_t opt_level;
+  // the amount of instructions following the header
+  uint64_t length;
+  // the length of the source code following the instructions. The source is
+  // compared as a whole when the file is loaded, since a hash of it could
+  // collide with another program's, which would then run this bytecode
+  uint64_t source_length;
+  // hash of the instructions following the header
+  uint64_t checksum;
+} ubf_cache_header_t;
+
+/// The result of loading a cache file.
+typedef enum {
+  UBF_CACHE_OK,
+  // the file couldn't be opened or mapped, or there was no memory for the
+  // program
+  UBF_CACHE_IO_ERROR,
+  // the file wasn't written by this version of microbf on this kind of host
+  UBF_CACHE_BAD_FORMAT,
+  // the file was compiled from different source code or at a different
+  // optimization level
+  UBF_CACHE_STALE,
+  // the checksum didn't match, or the bytecode failed verification
+  UBF_CACHE_CORRUPT
+} ubf_cache_result;
+
+/// A chunk loaded from a cache file.
+/// The chunk's code points straight into the read-only mapping of the file.
+typedef struct {
+  ubf_chunk_t chunk;
+  void *mapping;
+  size_t size;
+} ubf_cached_chunk_t;
+
+/// Hashes `length` bytes of data (64-bit FNV-1a). This isn't collision
+/// resistant, so it's only good for naming cache files, not for telling
+/// whether a file belongs to some source code.
+uint64_t ubf_hash(const void *data, size_t length);
+
+/// Checks that a chunk of bytecode is safe to run: every opcode is valid,
+/// every jump lands in the chunk and is paired with its counterpart, no
+/// instruction reaches past the tape's margin, and the chunk ends with FIN.
+/// Chunks produced by the compiler always pass, this is meant for bytecode
+/// read from outside.
+bool ubf_verify_chunk(const ubf_chunk_t *chunk);
+
+/// Writes a chunk compiled from `source` at `opt_level` to a cache file. The
+/// file is replaced atomically, so concurrent readers never see a partially
+/// written file.
+/// Returns false if the file couldn't be written.
+bool ubf_cache_write(const char *path, const ubf_chunk_t *chunk,
+                     const char *source, size_t source_length, int opt_level);
+
+/// Maps a cache file into memory and checks that it was compiled from exactly
+/// `source`, at the given optimization level. The chunk is verified once here,
+/// so it can be run without any further checks.
+ubf_cache_result ubf_cache_load(const char *path, const char *source,
+                                size_t source_length, int opt_level,
+                                ubf_cached_chunk_t *cached);
+
+/// Unmaps a previously loaded cache file.
+void ubf_cache_unload(ubf_cached_chunk_t *cached);
+
+/// Writes a program's bytecode, compiled from `source`, to a cache file.
+bool ubf_cache_write_program(const char *path, const ubf_program_t *program,
+                             const char *source, size_t source_length);
+
+/// Loads a program compiled from `source` at `opt_level` from a cache file.
+/// The program runs straight from the mapped file, which stays mapped until
+/// the program is released.
+/// Returns NULL if the file can't be used, with the reason in `result`.
+ubf_program_t *ubf_cache_load_program(const char *path, const char *source,
+                                      size_t source_length, int opt_level,
+                                      ubf_cache_result *result);
+
+#endif
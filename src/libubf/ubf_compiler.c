@@ -7,140 +7,437 @@
 #ifndef ubf_compiler_c
 #define ubf_compiler_c
 
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "ubf_compiler.h"
+#include "ubf_fusion.h"
+#include "ubf_options.h"
 
-void ubf__realloc_chunk(ubf_chunk_t *chunk, size_t capacity) {
-  if (chunk->bytecode == NULL) {
-    chunk->bytecode = (uint8_t *)malloc(capacity * sizeof(uint8_t));
-  } else {
-    uint8_t *new_bytecode = (uint8_t *)malloc(capacity * sizeof(uint8_t));
-    memcpy((void *)new_bytecode, (void *)chunk->bytecode, chunk->capacity);
-    free(chunk->bytecode);
-    chunk->bytecode = new_bytecode;
+#ifdef UBF_COMPILER_USE_SSE2
+# include <emmintrin.h>
+#endif
+
+const ubf_opcode_info_t ubf_opcode_info[UBF_OPCODE_COUNT] = {
+  [UBF_INC] = { 1, { UBF_INC } },   [UBF_DEC] = { 1, { UBF_DEC } },
+  [UBF_LT] = { 1, { UBF_LT } },     [UBF_RT] = { 1, { UBF_RT } },
+  [UBF_JZ] = { 1, { UBF_JZ } },     [UBF_JNZ] = { 1, { UBF_JNZ } },
+  [UBF_PUT] = { 1, { UBF_PUT } },   [UBF_GET] = { 1, { UBF_GET } },
+  [UBF_SET] = { 1, { UBF_SET } },   [UBF_MUL] = { 1, { UBF_MUL } },
+  [UBF_SCAN] = { 1, { UBF_SCAN } },
+  [UBF_FIN] = { 1, { UBF_FIN } },
+  #define UBF_FUSED2(a, b) \
+    [UBF_##a##_##b] = { 2, { UBF_##a, UBF_##b } },
+  #define UBF_FUSED3(a, b, c) \
+    [UBF_##a##_##b##_##c] = { 3, { UBF_##a, UBF_##b, UBF_##c } },
+  UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+  #undef UBF_FUSED2
+  #undef UBF_FUSED3
+};
+
+// Resizes a chunk to hold `capacity` instructions. Returns false if the
+// allocator runs out of memory, leaving the chunk as it was.
+bool ubf__realloc_chunk(ubf_chunk_t *chunk, size_t capacity) {
+  // the source map is copied to a new block rather than resized in place, so
+  // that the code and the map are either both resized or neither is
+  size_t *offsets = NULL;
+  if (chunk->map != NULL && capacity != 0) {
+    offsets = (size_t *)
+      ubf__allocate(chunk->allocator, capacity * sizeof(size_t));
+    if (offsets == NULL) return false;
+  }
+  ubf_instr_t *code = (ubf_instr_t *)
+    ubf__reallocate(chunk->allocator, chunk->code,
+                    chunk->capacity * sizeof(ubf_instr_t),
+                    capacity * sizeof(ubf_instr_t));
+  if (code == NULL && capacity != 0) {
+    ubf__deallocate(chunk->allocator, offsets, capacity * sizeof(size_t));
+    return false;
   }
+  if (chunk->map != NULL) {
+    size_t kept = (chunk->length < capacity) ? chunk->length : capacity;
+    if (kept != 0) {
+      memcpy(offsets, chunk->map->offsets, kept * sizeof(size_t));
+    }
+    ubf__deallocate(chunk->allocator, chunk->map->offsets,
+                    chunk->capacity * sizeof(size_t));
+    chunk->map->offsets = offsets;
+  }
+  chunk->code = code;
   chunk->capacity = capacity;
+  return true;
 }
 
-ubf_chunk_t *ubf__alloc_chunk(size_t initial_capacity) {
-  ubf_chunk_t *chunk = (ubf_chunk_t *)malloc(sizeof(ubf_chunk_t));
+ubf_chunk_t *ubf__alloc_chunk(const ubf_allocator_t *allocator,
+                              size_t initial_capacity) {
+  ubf_chunk_t *chunk =
+    (ubf_chunk_t *)ubf__allocate(allocator, sizeof(ubf_chunk_t));
+  if (chunk == NULL) return NULL;
 
-  chunk->bytecode = NULL;
+  chunk->code = NULL;
   chunk->length = 0;
   chunk->capacity = 0;
-  chunk->offset_length = 0;
+  chunk->map = NULL;
+  chunk->allocator = allocator;
 
-  ubf__realloc_chunk(chunk, initial_capacity);
+  if (!ubf__realloc_chunk(chunk, initial_capacity)) {
+    ubf__deallocate(allocator, chunk, sizeof(ubf_chunk_t));
+    return NULL;
+  }
 
   return chunk;
 }
 
 void ubf__free_chunk(ubf_chunk_t *chunk) {
-  free(chunk->bytecode);
-  free(chunk);
+  const ubf_allocator_t *allocator = chunk->allocator;
+  if (chunk->map != NULL) {
+    ubf__deallocate(allocator, chunk->map->offsets,
+                    chunk->capacity * sizeof(size_t));
+    ubf__deallocate(allocator, chunk->map, sizeof(ubf_source_map_t));
+  }
+  ubf__deallocate(allocator, chunk->code,
+                  chunk->capacity * sizeof(ubf_instr_t));
+  ubf__deallocate(allocator, chunk, sizeof(ubf_chunk_t));
+}
+
+bool ubf__map_chunk(ubf_chunk_t *chunk) {
+  ubf_source_map_t *map = (ubf_source_map_t *)
+    ubf__allocate(chunk->allocator, sizeof(ubf_source_map_t));
+  if (map == NULL) return false;
+  map->offsets = NULL;
+  if (chunk->capacity != 0) {
+    map->offsets = (size_t *)
+      ubf__allocate(chunk->allocator, chunk->capacity * sizeof(size_t));
+    if (map->offsets == NULL) {
+      ubf__deallocate(chunk->allocator, map, sizeof(ubf_source_map_t));
+      return false;
+    }
+  }
+  map->position = 0;
+  chunk->map = map;
+  return true;
 }
 
 void ubf__chunk_print(ubf_chunk_t *chunk) {
   for (size_t i = 0; i < chunk->length; i++) {
-    printf("%02x ", (int) chunk->bytecode[i]);
+    printf("%02x:%d ", (int) chunk->code[i].opcode, chunk->code[i].operand);
   }
   printf("\n");
 }
 
-void ubf__chunk_write(ubf_chunk_t *chunk, uint8_t byte) {
-  if (chunk->capacity < chunk->length + 1) {
-    ubf__realloc_chunk(chunk, (chunk->capacity < 8) ? 8 : chunk->capacity * 2);
+// Appends an instruction to a chunk, which must have room for it. Returns the
+// instruction's index.
+size_t ubf__chunk_write(ubf_chunk_t *chunk, uint8_t opcode, int32_t operand,
+                        int32_t offset) {
+  chunk->code[chunk->length].opcode = opcode;
+  chunk->code[chunk->length].operand = operand;
+  chunk->code[chunk->length].offset = offset;
+  if (chunk->map != NULL) {
+    chunk->map->offsets[chunk->length] = chunk->map->position;
   }
-  chunk->bytecode[chunk->length] = byte;
-  chunk->length++;
+  return chunk->length++;
 }
 
-uint8_t ubf__chunk_offset(ubf_chunk_t *chunk, size_t offset) {
-  for (size_t i = 0; i < chunk->offset_length; i++) {
-    if (chunk->offset_table[i] == offset) {
-      return (uint8_t) i;
+// Whether a byte is one of brainfuck's commands. Everything else is a comment.
+static const bool ubf__is_command[256] = {
+  ['+'] = true, ['-'] = true, ['<'] = true, ['>'] = true,
+  ['['] = true, [']'] = true, ['.'] = true, [','] = true
+};
+
+// Returns the index of the first command at or after `index`, or `length` if
+// there are none left. Generated code is often mostly comments, so they're
+// skipped over 16 bytes at a time where possible.
+size_t ubf__skip_comments(const char *code, size_t index, size_t length) {
+  // in dense code, the next command is usually right there
+  if (index < length && ubf__is_command[(uint8_t) code[index]]) return index;
+
+  #ifdef UBF_COMPILER_USE_SSE2
+  const __m128i commands[] = {
+    _mm_set1_epi8('+'), _mm_set1_epi8('-'), _mm_set1_epi8('<'),
+    _mm_set1_epi8('>'), _mm_set1_epi8('['), _mm_set1_epi8(']'),
+    _mm_set1_epi8('.'), _mm_set1_epi8(',')
+  };
+  for (; index + 16 <= length; index += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *) &code[index]);
+    __m128i hits = _mm_setzero_si128();
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, commands[i]));
+    }
+    unsigned mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return index + __builtin_ctz(mask);
     }
   }
-  uint8_t id = (uint8_t) chunk->offset_length;
-  chunk->offset_table[chunk->offset_length] = offset;
-  chunk->offset_length++;
-  return id;
+  #endif
+
+  while (index < length && !ubf__is_command[(uint8_t) code[index]]) index++;
+  return index;
+}
+
+void ubf_init_compile_options(ubf_compile_options_t *options) {
+  options->opt_level = UBF_OPT_LEVEL;
+  options->disabled_passes = 0;
+  options->dump = NULL;
+  options->stats = NULL;
+  options->allocator = &ubf_libc_allocator;
 }
 
-int ubf__compile_char(const char *code, size_t length,
-                      ubf_chunk_t *chunk,
-                      size_t pos) {
-  #define AT_END (index >= length)
+ubf_compile_result ubf__parse(const char *code, size_t length, ubf_ir_t *ir) {
   #define PEEK() code[index]
-  #define NEXT() index++
-  #define COLLECT(ch, opcode) \
+  #define COUNT(ch, amt) \
     do { \
-      int amt = 0; \
-      while (amt < 256 && PEEK() == ch) { \
+      amt = 0; \
+      while (amt < INT32_MAX && index < length && PEEK() == ch) { \
         amt++; \
-        NEXT(); \
+        index++; \
       } \
-      ubf__chunk_write(chunk, opcode); \
-      ubf__chunk_write(chunk, (uint8_t) amt); \
-    } while (false);
-
-  size_t index = pos;
-
-  switch (PEEK()) {
-    case '+':
-      COLLECT('+', UBF_INC); break;
-    case '-':
-      COLLECT('-', UBF_DEC); break;
-    case '<':
-      COLLECT('<', UBF_LT); break;
-    case '>':
-      COLLECT('>', UBF_RT); break;
-    case '.':
-      COLLECT('.', UBF_PUT); break;
-    case ',':
-      COLLECT(',', UBF_GET); break;
-    case '[':
-      NEXT();
-      size_t jz_pos = chunk->length;
-      uint8_t jz_offset = ubf__chunk_offset(chunk, jz_pos);
-      ubf__chunk_write(chunk, UBF_JZ);
-      ubf__chunk_write(chunk, 0);
-
-      while (PEEK() != ']' && !AT_END) {
-        index = ubf__compile_char(code, length, chunk, index);
+    } while (false)
+
+  // the loop the parser is in, so nesting is only limited by memory and not
+  // by the C stack, and the block it's adding operations to, if any
+  ubf_ir_node_t *loop = &ir->root;
+  ubf_ir_node_t *block = NULL;
+  size_t index = 0;
+
+  while ((index = ubf__skip_comments(code, index, length)) < length) {
+    // operations map to the character their run starts at
+    size_t start = index;
+    char ch = PEEK();
+    ubf_ir_opcode opcode;
+    int32_t sign = 1;
+    switch (ch) {
+      case '+': opcode = UBF_IR_ADD; break;
+      case '-': opcode = UBF_IR_ADD; sign = -1; break;
+      case '>': opcode = UBF_IR_MOVE; break;
+      case '<': opcode = UBF_IR_MOVE; sign = -1; break;
+      case '.': opcode = UBF_IR_PUT; break;
+      case ',': opcode = UBF_IR_GET; break;
+      case '[':
+        loop = ubf__ir_append(ir, loop, UBF_IR_LOOP);
+        loop->start = index++;
+        block = NULL;
+        continue;
+      default: // ']'
+        if (loop == &ir->root) return UBF_COMPILE_UNBALANCED_LOOP;
+        loop->end = index++;
+        loop = loop->parent;
+        block = NULL;
+        continue;
+    }
+    int32_t amt;
+    COUNT(ch, amt);
+    if (block == NULL) block = ubf__ir_append(ir, loop, UBF_IR_BLOCK);
+    ubf__ir_push(ir, block, opcode, sign * amt, 0, start);
+  }
+  if (loop != &ir->root) {
+    return UBF_COMPILE_UNBALANCED_LOOP;
+  }
+  ir->root.end = length;
+  return UBF_COMPILE_OK;
+
+  #undef PEEK
+  #undef COUNT
+}
+
+// Counts the instructions IR is lowered to, and how deeply its loops nest.
+void ubf__measure_ir(const ubf_ir_t *ir, size_t *length, size_t *depth) {
+  // FIN comes at the end
+  size_t count = 1, level = 0, deepest = 0;
+  const ubf_ir_node_t *node = ir->root.first;
+  while (node != NULL) {
+    if (node->kind == UBF_IR_LOOP) {
+      // a JZ and a JNZ
+      count += 2;
+      if (++level > deepest) deepest = level;
+      if (node->first != NULL) {
+        node = node->first;
+        continue;
       }
-      NEXT();
+      level--;
+    } else {
+      count += node->length;
+    }
+    while (node->next == NULL && node->parent != &ir->root) {
+      node = node->parent;
+      level--;
+    }
+    node = node->next;
+  }
+  *length = count;
+  *depth = deepest;
+}
 
-      ubf__chunk_write(chunk, UBF_JNZ);
-      ubf__chunk_write(chunk, jz_offset);
-      uint8_t jnz_offset = ubf__chunk_offset(chunk, chunk->length);
+ubf_compile_result ubf__lower(const ubf_ir_t *ir, ubf_chunk_t *chunk) {
+  // instructions map to the source of the operations they're lowered from,
+  // jumps to their brackets, and FIN to the end of the code
+  #define MAP(at) if (chunk->map != NULL) chunk->map->position = (at)
+  // jumps are relative to the instruction following them, so both land just
+  // past their counterpart
+  #define CLOSE(loop) \
+    do { \
+      MAP((loop)->end); \
+      size_t jz_pos = jumps[--depth]; \
+      size_t jnz_pos = ubf__chunk_write(chunk, UBF_JNZ, 0, 0); \
+      chunk->code[jnz_pos].operand = (int32_t) (jz_pos - jnz_pos); \
+      chunk->code[jz_pos].operand = (int32_t) (jnz_pos - jz_pos); \
+    } while (false)
 
-      chunk->bytecode[jz_pos + 1] = jnz_offset;
-      break;
-    default: // comments
-      NEXT();
-      break;
+  // everything is allocated up front, so running out of memory is only
+  // checked for once, and never leaves the chunk half-written
+  size_t length, capacity;
+  ubf__measure_ir(ir, &length, &capacity);
+  // the JZs of the loops being lowered, innermost last
+  size_t *jumps = NULL;
+  size_t depth = 0;
+  if (capacity != 0) {
+    jumps = (size_t *)
+      ubf__allocate(chunk->allocator, capacity * sizeof(size_t));
+    if (jumps == NULL) return UBF_COMPILE_OUT_OF_MEMORY;
+  }
+  if (chunk->capacity - chunk->length < length
+      && !ubf__realloc_chunk(chunk, chunk->length + length)) {
+    ubf__deallocate(chunk->allocator, jumps, capacity * sizeof(size_t));
+    return UBF_COMPILE_OUT_OF_MEMORY;
   }
 
-  return index;
+  const ubf_ir_node_t *node = ir->root.first;
+  while (node != NULL) {
+    if (node->kind == UBF_IR_LOOP) {
+      MAP(node->start);
+      jumps[depth++] = ubf__chunk_write(chunk, UBF_JZ, 0, 0);
+      if (node->first != NULL) {
+        node = node->first;
+        continue;
+      }
+      CLOSE(node);
+    } else {
+      for (size_t i = 0; i < node->length; i++) {
+        const ubf_ir_op_t *op = &node->ops[i];
+        int32_t magnitude = (op->value < 0) ? -op->value : op->value;
+        MAP(op->source);
+        switch (op->opcode) {
+          case UBF_IR_ADD:
+            ubf__chunk_write(chunk, (op->value < 0) ? UBF_DEC : UBF_INC,
+                             magnitude, op->offset);
+            break;
+          case UBF_IR_MOVE:
+            ubf__chunk_write(chunk, (op->value < 0) ? UBF_LT : UBF_RT,
+                             magnitude, 0);
+            break;
+          case UBF_IR_SET:
+            ubf__chunk_write(chunk, UBF_SET, op->value, op->offset);
+            break;
+          case UBF_IR_MUL:
+            ubf__chunk_write(chunk, UBF_MUL, op->value, op->offset);
+            break;
+          case UBF_IR_SCAN:
+            ubf__chunk_write(chunk, UBF_SCAN, op->value, 0);
+            break;
+          case UBF_IR_PUT:
+            ubf__chunk_write(chunk, UBF_PUT, op->value, op->offset);
+            break;
+          case UBF_IR_GET:
+            ubf__chunk_write(chunk, UBF_GET, op->value, op->offset);
+            break;
+        }
+      }
+    }
+    // close every loop whose body ends here
+    while (node->next == NULL && node->parent != &ir->root) {
+      node = node->parent;
+      CLOSE(node);
+    }
+    node = node->next;
+  }
+  ubf__deallocate(chunk->allocator, jumps, capacity * sizeof(size_t));
 
-  #undef AT_END
-  #undef PEEK
-  #undef NEXT
-  #undef COLLECT
+  MAP(ir->root.end);
+  ubf__chunk_write(chunk, UBF_FIN, 0, 0);
+  return UBF_COMPILE_OK;
+
+  #undef MAP
+  #undef CLOSE
 }
 
-void ubf_compile(const char *code, size_t length, ubf_chunk_t *chunk) {
-  size_t index = 0;
-  while (index < length) {
-    index = ubf__compile_char(code, length, chunk, index);
+// Returns the time since `start`, in seconds.
+double ubf__seconds_since(const struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Parses code into IR and optimizes it. The IR's allocations happen all over
+// the parser and the passes, so when one fails, it longjmps back here. All of
+// the IR lives in its arena, so nothing leaks.
+ubf_compile_result ubf__build_ir(const char *code, size_t length,
+                                 const ubf_compile_options_t *options,
+                                 ubf_ir_t *ir) {
+  ubf_compile_stats_t *stats = options->stats;
+  struct timespec start;
+  jmp_buf trap;
+  if (setjmp(trap) != 0) {
+    ir->out_of_memory = NULL;
+    return UBF_COMPILE_OUT_OF_MEMORY;
+  }
+  ir->out_of_memory = &trap;
+
+  if (stats != NULL) clock_gettime(CLOCK_MONOTONIC, &start);
+  ubf_compile_result result = ubf__parse(code, length, ir);
+  if (stats != NULL) stats->parse_seconds += ubf__seconds_since(&start);
+  if (result == UBF_COMPILE_OK) {
+    ubf__run_passes(ir, options->opt_level, options->disabled_passes,
+                    options->dump, stats);
+  }
+  ir->out_of_memory = NULL;
+  return result;
+}
+
+ubf_compile_result ubf__compile_bytecode(const char *code, size_t length,
+                                         const ubf_compile_options_t *options,
+                                         ubf_chunk_t *chunk) {
+  ubf_compile_options_t defaults;
+  if (options == NULL) {
+    ubf_init_compile_options(&defaults);
+    options = &defaults;
+  }
+  ubf_compile_stats_t *stats = options->stats;
+  struct timespec start;
+
+  // the IR only lives until it's lowered, and its memory comes from the same
+  // place as the chunk's
+  ubf_ir_t ir;
+  ubf__init_ir(&ir, chunk->allocator);
+  ubf_compile_result result = ubf__build_ir(code, length, options, &ir);
+  if (result != UBF_COMPILE_OK) {
+    ubf__free_ir(&ir);
+    return result;
   }
-  ubf__chunk_write(chunk, UBF_FIN);
+
+  if (stats != NULL) clock_gettime(CLOCK_MONOTONIC, &start);
+  result = ubf__lower(&ir, chunk);
+  if (stats != NULL) {
+    stats->lower_seconds += ubf__seconds_since(&start);
+    if (result == UBF_COMPILE_OK) stats->programs++;
+  }
+  ubf__free_ir(&ir);
+  return result;
+}
+
+ubf_compile_result ubf_compile(const char *code, size_t length,
+                               const ubf_compile_options_t *options,
+                               ubf_chunk_t *chunk) {
+  ubf_compile_result result =
+    ubf__compile_bytecode(code, length, options, chunk);
+  if (result != UBF_COMPILE_OK) return result;
+  ubf_fusion_set_t fusions;
+  ubf_default_fusions(&fusions);
+  ubf__fuse(chunk, &fusions);
+  return UBF_COMPILE_OK;
 }
 
 #endif
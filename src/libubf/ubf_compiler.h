@@ -10,39 +10,192 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+
+#include "ubf_alloc.h"
+#include "ubf_brainfuck.h"
+#include "ubf_ir.h"
+#include "ubf_passes.h"
 
 /// Result of compilation.
 typedef enum {
   UBF_COMPILE_OK,
-  UBF_COMPILE_UNBALANCED_LOOP
+  // a [ without a matching ], or the other way around
+  UBF_COMPILE_UNBALANCED_LOOP,
+  // the allocator ran out of memory
+  UBF_COMPILE_OUT_OF_MEMORY
 } ubf_compile_result;
 
+/// The superinstructions: sequences of opcodes executed by a single handler.
+/// Only the opcode of the sequence's first instruction is replaced, the rest
+/// keep their own, so the handler reads every part's operands from the
+/// instruction it came from, and a jump into the middle of a sequence still
+/// lands on a regular instruction.
+/// X2 is called with every pair of opcodes, X3 with every triple, and the
+/// opcodes are named after their parts, eg. UBF_DEC_JNZ.
+#define UBF_SUPERINSTRUCTIONS(X2, X3) \
+  /* the ends of loops */             \
+  X2(INC, JNZ)                        \
+  X2(DEC, JNZ)                        \
+  X2(LT, JNZ)                         \
+  X2(RT, JNZ)                         \
+  X2(LT, JZ)                          \
+  X2(RT, JZ)                          \
+  X3(INC, LT, JNZ)                    \
+  X3(INC, RT, JNZ)                    \
+  X3(DEC, LT, JNZ)                    \
+  X3(DEC, RT, JNZ)                    \
+  X2(MUL, SET)                        \
+  X3(MUL, MUL, SET)                   \
+  /* loop bodies */                   \
+  X2(INC, INC)                        \
+  X2(INC, DEC)                        \
+  X2(DEC, INC)                        \
+  X2(DEC, DEC)                        \
+  X2(SET, INC)                        \
+  X2(SET, DEC)                        \
+  X2(INC, SET)                        \
+  X2(JZ, INC)                         \
+  X2(JZ, DEC)                         \
+  X2(JNZ, INC)                        \
+  X2(JNZ, DEC)                        \
+  X2(PUT, INC)                        \
+  X2(PUT, DEC)                        \
+  X3(INC, INC, INC)                   \
+  X3(INC, INC, SET)                   \
+  X3(INC, SET, DEC)                   \
+  X3(SET, DEC, JNZ)                   \
+  X3(JNZ, INC, INC)
+
 /// A microbf opcode.
 typedef enum {
   UBF_INC, UBF_DEC, // + and -
   UBF_LT,  UBF_RT,  // < and >
   UBF_JZ,  UBF_JNZ, // jump if zero, jump if not zero
   UBF_PUT, UBF_GET, // . and ,
-  UBF_FIN
+  UBF_SET,          // [-], optionally followed by + or -
+  UBF_MUL,          // a single step of a multiplication loop, eg. [->++<]
+  UBF_SCAN,         // [>], [<<], etc.
+  UBF_FIN,
+  // superinstructions
+  #define UBF_FUSED2(a, b) UBF_##a##_##b,
+  #define UBF_FUSED3(a, b, c) UBF_##a##_##b##_##c,
+  UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+  #undef UBF_FUSED2
+  #undef UBF_FUSED3
+  UBF_OPCODE_COUNT
 } ubf_opcode;
 
+/// What an opcode is made of.
+typedef struct {
+  // the amount of instructions the opcode executes, 1 for plain opcodes
+  uint8_t length;
+  // the opcodes of those instructions
+  uint8_t parts[3];
+} ubf_opcode_info_t;
+
+/// Information about every opcode, indexed by opcode.
+extern const ubf_opcode_info_t ubf_opcode_info[UBF_OPCODE_COUNT];
+
+/// Returns the plain opcode a superinstruction starts with, or the opcode
+/// itself if it's not a superinstruction. Code that doesn't care about
+/// superinstructions can treat every instruction as this opcode.
+static inline ubf_opcode ubf__base_opcode(uint8_t opcode) {
+  return (ubf_opcode) ubf_opcode_info[opcode].parts[0];
+}
+
+/// A single microbf instruction.
+/// Instructions are fixed-width and stored pre-decoded, so the VM can read the
+/// operand straight from the instruction it's dispatching on.
+typedef struct {
+  uint8_t opcode;
+  int32_t operand;
+  // offset of the cell the instruction operates on, relative to the pointer
+  // (used by INC, DEC, PUT, GET, SET, and MUL)
+  int32_t offset;
+} ubf_instr_t;
+
+/// Maps bytecode back to the source it was compiled from.
+typedef struct {
+  // offset of every instruction's source in the code, indexed like the chunk
+  size_t *offsets;
+  // offset of the character the compiler is at
+  size_t position;
+} ubf_source_map_t;
+
 /// A chunk of UBF bytecode.
 typedef struct {
-  uint8_t *bytecode;
+  ubf_instr_t *code;
   size_t length;
   size_t capacity;
-
-  size_t offset_table[256];
-  uint8_t offset_length;
+  // where the instructions came from, only recorded if this isn't NULL
+  ubf_source_map_t *map;
+  // where the chunk and everything in it is allocated from
+  const ubf_allocator_t *allocator;
 } ubf_chunk_t;
 
-/// Allocates a new chunk of bytecode.
-ubf_chunk_t *ubf__alloc_chunk(size_t initial_length);
+/// Allocates a new chunk of bytecode from `allocator`.
+/// Returns NULL if the allocator runs out of memory.
+ubf_chunk_t *ubf__alloc_chunk(const ubf_allocator_t *allocator,
+                              size_t initial_capacity);
 
 /// Frees a previously allocated chunk of bytecode.
 void ubf__free_chunk(ubf_chunk_t *chunk);
 
-/// Compiles brainfuck code into a chunk of bytecode.
-void ubf_compile(const char *code, size_t length, ubf_chunk_t *chunk);
+/// Makes the compiler record a source map for an empty chunk.
+/// Returns false if the allocator runs out of memory.
+bool ubf__map_chunk(ubf_chunk_t *chunk);
+
+/// How code is compiled.
+typedef struct {
+  // how hard the compiler optimizes, from 0 (not at all) to
+  // UBF_OPT_LEVEL_MAX; UBF_OPT_LEVEL by default
+  int opt_level;
+  // passes to skip even if the level includes them, a bit for every pass
+  // (1 << UBF_PASS_...)
+  uint32_t disabled_passes;
+  // if not NULL, the IR is written here after parsing and after every pass
+  FILE *dump;
+  // if not NULL, the time spent compiling and what every pass did are added
+  // to this
+  ubf_compile_stats_t *stats;
+  // where programs and their bytecode are allocated from
+  const ubf_allocator_t *allocator;
+} ubf_compile_options_t;
+
+/// Initializes compile options to the defaults.
+void ubf_init_compile_options(ubf_compile_options_t *options);
+
+/// Parses brainfuck code into IR, a block for every run of operations and a
+/// loop for every pair of brackets, without optimizing anything.
+ubf_compile_result ubf__parse(const char *code, size_t length, ubf_ir_t *ir);
+
+/// Lowers IR to bytecode, appending it to a chunk along with a FIN.
+/// If the chunk can't grow to fit it, nothing is appended, and
+/// UBF_COMPILE_OUT_OF_MEMORY is returned.
+ubf_compile_result ubf__lower(const ubf_ir_t *ir, ubf_chunk_t *chunk);
+
+/// Compiles brainfuck code into a chunk of bytecode, without fusing any
+/// instructions into superinstructions: the code is parsed into IR, optimized
+/// by the passes the options' level includes, and lowered to bytecode. Every
+/// step runs in time linear in the code's length, however deeply its loops are
+/// nested. NULL options are the defaults.
+/// If the code doesn't compile, or the chunk's allocator runs out of memory,
+/// the chunk is left empty.
+ubf_compile_result ubf__compile_bytecode(const char *code, size_t length,
+                                         const ubf_compile_options_t *options,
+                                         ubf_chunk_t *chunk);
+
+/// Compiles brainfuck code into a chunk of bytecode, using the default set of
+/// superinstructions. NULL options are the defaults.
+ubf_compile_result ubf_compile(const char *code, size_t length,
+                               const ubf_compile_options_t *options,
+                               ubf_chunk_t *chunk);
+
+/// Compiles `length` bytes of brainfuck code into a program, with the given
+/// options. Returns NULL if the code doesn't compile, or the allocator runs
+/// out of memory.
+ubf_program_t *ubf_compile_program_with_options(
+    const char *code, size_t length, const ubf_compile_options_t *options);
 
 #endif
@@ -12,34 +12,40 @@
 #include "ubf_debug.h"
 
 void ubf_disassemble(ubf_chunk_t* chunk) {
-  #define VAL(offset) chunk->bytecode[idx + offset]
-  #define WRITE(fmt, arg) \
-    printf(fmt, arg); \
-    idx += 2; \
-    break; \
-
-  for (size_t i = 0; i < chunk->length; i++) {
-    printf("%02x ", (int) chunk->bytecode[i]);
-  }
-  printf("\n");
+  #define OPERAND chunk->code[idx].operand
+  #define OFFSET chunk->code[idx].offset
+  // jumps are relative to the instruction following them
+  #define TARGET (int) (idx + 1 + OPERAND)
 
-  size_t idx = 0;
-  while (idx < chunk->length) {
+  for (size_t idx = 0; idx < chunk->length; idx++) {
     printf("%08x  ", (int) idx);
-    switch (VAL(0)) {
-      case UBF_INC: WRITE("INC %d\n", VAL(1));
-      case UBF_DEC: WRITE("DEC %d\n", VAL(1));
-      case UBF_LT:  WRITE("LT  %d\n", VAL(1));
-      case UBF_RT:  WRITE("RT  %d\n", VAL(1));
-      case UBF_PUT: WRITE("PUT %d\n", VAL(1));
-      case UBF_GET: WRITE("GET %d\n", VAL(1));
-      case UBF_JZ:  WRITE("JZ  @%08x\n", (int) chunk->offset_table[VAL(1)]);
-      case UBF_JNZ: WRITE("JNZ @%08x\n", (int) chunk->offset_table[VAL(1)]);
+    // a superinstruction keeps the operands of its first part, the rest of the
+    // parts follow it as plain instructions
+    uint8_t opcode = chunk->code[idx].opcode;
+    switch (ubf__base_opcode(opcode)) {
+      case UBF_INC: printf("INC %+d, %d", OFFSET, OPERAND); break;
+      case UBF_DEC: printf("DEC %+d, %d", OFFSET, OPERAND); break;
+      case UBF_LT:  printf("LT  %d", OPERAND); break;
+      case UBF_RT:  printf("RT  %d", OPERAND); break;
+      case UBF_PUT: printf("PUT %+d, %d", OFFSET, OPERAND); break;
+      case UBF_GET: printf("GET %+d, %d", OFFSET, OPERAND); break;
+      case UBF_SET: printf("SET %+d, %d", OFFSET, OPERAND); break;
+      case UBF_MUL: printf("MUL %+d, %d", OFFSET, OPERAND); break;
+      case UBF_SCAN: printf("SCAN %+d", OPERAND); break;
+      case UBF_JZ:  printf("JZ  %+d (@%08x)", OPERAND, TARGET); break;
+      case UBF_JNZ: printf("JNZ %+d (@%08x)", OPERAND, TARGET); break;
       case UBF_FIN: printf("FIN\n"); return;
+      default: break;
+    }
+    if (opcode > UBF_FIN) {
+      printf("  [%s]", ubf_get_opcode_name((ubf_opcode) opcode));
     }
+    printf("\n");
   }
 
-  #undef VAL
+  #undef OPERAND
+  #undef OFFSET
+  #undef TARGET
 }
 
 const char* ubf_get_opcode_name(ubf_opcode opcode) {
@@ -52,7 +58,16 @@ const char* ubf_get_opcode_name(ubf_opcode opcode) {
     case UBF_JNZ: return "JNZ";
     case UBF_PUT: return "PUT";
     case UBF_GET: return "GET";
+    case UBF_SET: return "SET";
+    case UBF_MUL: return "MUL";
+    case UBF_SCAN: return "SCAN";
     case UBF_FIN: return "FIN";
+    #define UBF_FUSED2(a, b) case UBF_##a##_##b: return #a ";" #b;
+    #define UBF_FUSED3(a, b, c) \
+      case UBF_##a##_##b##_##c: return #a ";" #b ";" #c;
+    UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+    #undef UBF_FUSED2
+    #undef UBF_FUSED3
     default:      return "<unknown>";
   }
 }
@@ -0,0 +1,148 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_fusion_c
+#define ubf_fusion_c
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ubf_debug.h"
+#include "ubf_fusion.h"
+#include "ubf_program.h"
+
+// The default set sticks to the ends of loops, which every program has: with
+// pointer movement deferred, a loop usually ends in an INC or DEC of its
+// counter, a move, and a JNZ. Triples come first, so they aren't broken up by
+// the pairs they start with.
+static const uint8_t ubf__default_fusions[] = {
+  UBF_INC_LT_JNZ, UBF_INC_RT_JNZ, UBF_DEC_LT_JNZ, UBF_DEC_RT_JNZ,
+  UBF_MUL_MUL_SET,
+  UBF_INC_JNZ, UBF_DEC_JNZ, UBF_LT_JNZ, UBF_RT_JNZ, UBF_LT_JZ, UBF_RT_JZ,
+  UBF_MUL_SET
+};
+
+void ubf_default_fusions(ubf_fusion_set_t *set) {
+  set->count = sizeof(ubf__default_fusions);
+  memcpy(set->opcodes, ubf__default_fusions, set->count);
+}
+
+// Parses an opcode name. Returns UBF_OPCODE_COUNT if there's no such opcode.
+uint8_t ubf__parse_opcode(const char *name) {
+  for (uint8_t op = 0; op <= UBF_FIN; op++) {
+    if (strcmp(name, ubf_get_opcode_name((ubf_opcode) op)) == 0) return op;
+  }
+  return UBF_OPCODE_COUNT;
+}
+
+bool ubf_load_fusion_profile(const char *path, ubf_fusion_set_t *set) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) return false;
+
+  // how many times each superinstruction's sequence ran
+  uint64_t counts[UBF_OPCODE_COUNT] = { 0 };
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    // the profile holds lots of other data, only the sequence counts matter
+    // here: "pair <count> <op> <op>" and "triple <count> <op> <op> <op>"
+    char kind[16], names[3][16];
+    unsigned long long count;
+    int fields = sscanf(line, "%15s %llu %15s %15s %15s", kind, &count,
+                        names[0], names[1], names[2]);
+    size_t length;
+    if (fields == 4 && strcmp(kind, "pair") == 0) {
+      length = 2;
+    } else if (fields == 5 && strcmp(kind, "triple") == 0) {
+      length = 3;
+    } else {
+      continue;
+    }
+    uint8_t parts[3];
+    for (size_t i = 0; i < length; i++) {
+      parts[i] = ubf__parse_opcode(names[i]);
+    }
+    for (uint8_t op = UBF_FIN + 1; op < UBF_OPCODE_COUNT; op++) {
+      const ubf_opcode_info_t *info = &ubf_opcode_info[op];
+      if (info->length == length
+          && memcmp(info->parts, parts, length) == 0) {
+        counts[op] += count;
+      }
+    }
+  }
+  fclose(file);
+
+  // a superinstruction saves a dispatch for every part after the first, so
+  // that's what they're ranked by
+  set->count = 0;
+  for (uint8_t op = UBF_FIN + 1; op < UBF_OPCODE_COUNT; op++) {
+    if (counts[op] == 0) continue;
+    uint64_t saved = counts[op] * (ubf_opcode_info[op].length - 1);
+    size_t i = set->count++;
+    for (; i > 0; i--) {
+      uint8_t other = set->opcodes[i - 1];
+      if (counts[other] * (ubf_opcode_info[other].length - 1) >= saved) break;
+      set->opcodes[i] = other;
+    }
+    set->opcodes[i] = op;
+  }
+  for (size_t i = 0; i < sizeof(ubf__default_fusions); i++) {
+    if (counts[ubf__default_fusions[i]] == 0) {
+      set->opcodes[set->count++] = ubf__default_fusions[i];
+    }
+  }
+
+  return true;
+}
+
+void ubf__fuse(ubf_chunk_t *chunk, const ubf_fusion_set_t *set) {
+  size_t i = 0;
+  while (i < chunk->length) {
+    size_t length = 1;
+    for (size_t s = 0; s < set->count; s++) {
+      const ubf_opcode_info_t *info = &ubf_opcode_info[set->opcodes[s]];
+      if (i + info->length > chunk->length) continue;
+      bool match = true;
+      for (size_t k = 0; k < info->length && match; k++) {
+        match = chunk->code[i + k].opcode == info->parts[k];
+      }
+      if (match) {
+        chunk->code[i].opcode = set->opcodes[s];
+        length = info->length;
+        break;
+      }
+    }
+    // sequences don't overlap, so every part of a superinstruction is still a
+    // plain instruction
+    i += length;
+  }
+}
+
+ubf_program_t *ubf_compile_program_fused(const char *code, size_t length,
+                                         const ubf_compile_options_t *options,
+                                         const ubf_fusion_set_t *set) {
+  ubf_compile_options_t defaults;
+  if (options == NULL) {
+    ubf_init_compile_options(&defaults);
+    options = &defaults;
+  }
+  ubf_program_t *program = ubf__alloc_program(options->allocator);
+  if (program == NULL) return NULL;
+  program->chunk = ubf__alloc_chunk(options->allocator, 0);
+  program->opt_level = options->opt_level;
+  if (program->chunk == NULL
+      || ubf__compile_bytecode(code, length, options, program->chunk)
+           != UBF_COMPILE_OK) {
+    ubf_release_program(program);
+    return NULL;
+  }
+  ubf__fuse(program->chunk, set);
+  return program;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_fusion_h
+#define ubf_fusion_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ubf_brainfuck.h"
+#include "ubf_compiler.h"
+
+/// A set of superinstructions for the compiler to fuse instructions into.
+/// Where two superinstructions overlap, the one that comes first wins.
+typedef struct {
+  uint8_t opcodes[UBF_OPCODE_COUNT];
+  size_t count;
+} ubf_fusion_set_t;
+
+/// Initializes the fixed set of superinstructions the compiler uses when it's
+/// not given a profile.
+void ubf_default_fusions(ubf_fusion_set_t *set);
+
+/// Picks the superinstructions for a program from a profile written by a
+/// previous run of it (see `ubf --profile`). The sequences that ran most often
+/// get the highest priority, followed by the default set.
+/// Returns false if the profile couldn't be read.
+bool ubf_load_fusion_profile(const char *path, ubf_fusion_set_t *set);
+
+/// Replaces sequences of instructions in a chunk with superinstructions from
+/// the set.
+void ubf__fuse(ubf_chunk_t *chunk, const ubf_fusion_set_t *set);
+
+/// Compiles a program, fusing instructions into the given superinstructions
+/// instead of the default ones. NULL options are the defaults.
+/// Returns NULL if the code doesn't compile, or the allocator runs out of
+/// memory.
+ubf_program_t *ubf_compile_program_fused(const char *code, size_t length,
+                                         const ubf_compile_options_t *options,
+                                         const ubf_fusion_set_t *set);
+
+/* -------------------------------------------------------------------------- */
+/* Superinstruction parts                                                     */
+/* -------------------------------------------------------------------------- */
+
+// Every engine builds its superinstruction handlers out of these. The engine
+// defines UBF_PART_PTR (the tape pointer), UBF_PART_INSTR(k) (the instruction
+// part k was fused from), UBF_PART_JUMP(k) (takes part k's jump and
+// dispatches the instruction it lands on), UBF_PART_LOOP(k) (the same for a
+// jump back to the start of a loop, which charges the loop's fuel first), and
+// UBF_PART_HALT(n) (stops the program for ubf_resume, so that it resumes at
+// part n; every part is still a plain instruction in its own slot).
+
+#define UBF_PART_OPERAND(k) (UBF_PART_INSTR(k)->operand)
+#define UBF_PART_CELL(k) (UBF_PART_PTR[UBF_PART_INSTR(k)->offset])
+
+#define UBF_PART_INC(k) UBF_PART_CELL(k) += UBF_PART_OPERAND(k);
+#define UBF_PART_DEC(k) UBF_PART_CELL(k) -= UBF_PART_OPERAND(k);
+#define UBF_PART_LT(k)                                             \
+  UBF_PART_PTR = ubf__tape_move(vm, UBF_PART_PTR,                  \
+                                -(ptrdiff_t) UBF_PART_OPERAND(k));
+#define UBF_PART_RT(k)                                             \
+  UBF_PART_PTR = ubf__tape_move(vm, UBF_PART_PTR,                  \
+                                UBF_PART_OPERAND(k));
+#define UBF_PART_JZ(k) if (*UBF_PART_PTR == 0) { UBF_PART_JUMP(k); }
+#define UBF_PART_JNZ(k) if (*UBF_PART_PTR != 0) { UBF_PART_LOOP(k); }
+#define UBF_PART_PUT(k)                                            \
+  ubf__put(vm, &UBF_PART_CELL(k), UBF_PART_OPERAND(k));            \
+  if (vm->halt != UBF_OK) { UBF_PART_HALT((k) + 1); }
+#define UBF_PART_GET(k)                                            \
+  ubf__get(vm, &UBF_PART_CELL(k), UBF_PART_OPERAND(k));            \
+  if (vm->halt != UBF_OK) { UBF_PART_HALT(k); }
+#define UBF_PART_SET(k) UBF_PART_CELL(k) = UBF_PART_OPERAND(k);
+#define UBF_PART_MUL(k) UBF_PART_CELL(k) += UBF_PART_OPERAND(k) * *UBF_PART_PTR;
+#define UBF_PART_SCAN(k) \
+  UBF_PART_PTR = ubf__tape_scan(vm, UBF_PART_PTR, UBF_PART_OPERAND(k));
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+// The execution loop, instantiated once for every cell width and overflow
+// behavior by including this file with these defined:
+//   UBF_INTERP_NAME      the name of the function
+//   UBF_INTERP_CELL      the cell's type, an unsigned integer
+//   UBF_INTERP_SATURATE  1 if cells saturate, 0 if they wrap
+// so the width is fixed within each instantiation, and nothing on the hot
+// path has to check it. The parameters are undefined again at the end, and
+// the file is meant to be included more than once, so it doesn't have an
+// include guard.
+
+ubf_interpret_result UBF_INTERP_NAME(ubf_vm_t *vm, ubf_chunk_t *chunk) {
+  // microbf uses computed gotos for code execution.
+  // You can read more on that here:
+  // https://eli.thegreenplace.net/2012/07/12/computed-goto-for-efficient-dispatch-tables
+  typedef UBF_INTERP_CELL cell_t;
+  #define MAX ((cell_t) -1)
+  #define READ() (instr = &chunk->code[vm->pc++])
+  #define OPERAND(k) (instr[k].operand)
+  #define CELL(k) (ptr[instr[k].offset])
+  #ifdef UBF_VM_USE_COMPUTED_GOTO
+  # define DISPATCH() goto *dispatch_table[READ()->opcode]
+  static void *dispatch_table[] = {
+    &&_UBF_INC, &&_UBF_DEC,
+    &&_UBF_LT,  &&_UBF_RT,
+    &&_UBF_JZ,  &&_UBF_JNZ,
+    &&_UBF_PUT, &&_UBF_GET,
+    &&_UBF_SET, &&_UBF_MUL,
+    &&_UBF_SCAN,
+    &&_UBF_FIN,
+    #define UBF_FUSED2(a, b) &&_UBF_##a##_##b,
+    #define UBF_FUSED3(a, b, c) &&_UBF_##a##_##b##_##c,
+    UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+    #undef UBF_FUSED2
+    #undef UBF_FUSED3
+  };
+  # define CASE(e) _##e:
+  #else
+  # define DISPATCH() break
+  # define CASE(e) case e:
+  #endif
+
+  // Every instruction is written as a part, so superinstructions can be built
+  // out of the same code. Wrapping cells use C's unsigned arithmetic as is;
+  // saturating ones clamp every result to [0, MAX].
+  #if UBF_INTERP_SATURATE
+  # define ADD(k, amount) CELL(k) = ubf__saturate(CELL(k), (amount), MAX)
+  # define PART_SET(k)                                                    \
+      CELL(k) = (OPERAND(k) < 0) ? 0                                      \
+              : ((uint64_t) OPERAND(k) > MAX) ? MAX                       \
+              : (cell_t) OPERAND(k);
+  # define PART_MUL(k)                                                    \
+      CELL(k) = ubf__saturate_mul(CELL(k), OPERAND(k), *ptr, MAX);
+  #else
+  # define ADD(k, amount) CELL(k) += (cell_t) (amount)
+  # define PART_SET(k) CELL(k) = (cell_t) OPERAND(k);
+  # define PART_MUL(k) CELL(k) += (cell_t) ((uint64_t) OPERAND(k) * *ptr);
+  #endif
+  #define PART_INC(k) ADD(k, (int64_t) OPERAND(k));
+  #define PART_DEC(k) ADD(k, -(int64_t) OPERAND(k));
+  #define PART_LT(k)                                                      \
+    ptr = (cell_t *) ubf__tape_move_cells(vm, ptr,                        \
+                                          -(ptrdiff_t) OPERAND(k),        \
+                                          sizeof(cell_t));
+  #define PART_RT(k)                                                      \
+    ptr = (cell_t *) ubf__tape_move_cells(vm, ptr, OPERAND(k),            \
+                                          sizeof(cell_t));
+  #define JUMP(k) vm->pc += (k) + OPERAND(k); DISPATCH()
+  // a loop's jump back costs as much fuel as there are instructions in its
+  // body, which is how far back it jumps
+  #define LOOP(k)                                                         \
+    vm->pc += (k) + OPERAND(k);                                           \
+    if (fuel < (uint64_t) -(int64_t) OPERAND(k)) goto out_of_fuel;        \
+    fuel -= (uint64_t) -(int64_t) OPERAND(k);                             \
+    DISPATCH()
+  #define PART_JZ(k) if (*ptr == 0) { JUMP(k); }
+  #define PART_JNZ(k) if (*ptr != 0) { LOOP(k); }
+  // I/O may have to stop the program in ubf_resume: after output, and before
+  // input, which is executed again when the program resumes
+  #define PART_PUT(k)                                                     \
+    ubf__put_byte(vm, (uint8_t) CELL(k), OPERAND(k));                     \
+    if (vm->halt != UBF_OK) { vm->pc += (k); goto halt; }
+  #define PART_GET(k)                                                     \
+    CELL(k) = (cell_t) ubf__get_value(vm, CELL(k), OPERAND(k));           \
+    if (vm->halt != UBF_OK) { vm->pc += (k) - 1; goto halt; }
+  #define PART_SCAN(k)                                                    \
+    ptr = (cell_t *) ubf__tape_scan_cells(vm, ptr, OPERAND(k),            \
+                                          sizeof(cell_t));
+
+  const ubf_instr_t *instr;
+  // the tape pointer and the fuel are kept in locals, and only written back
+  // to the VM when the program stops
+  cell_t *ptr = (cell_t *) vm->ptr;
+  uint64_t fuel = vm->fuel;
+
+  #ifdef UBF_VM_USE_COMPUTED_GOTO
+  DISPATCH();
+  while (true) {
+  #else
+  while (true) {
+    switch (READ()->opcode) {
+  #endif
+      CASE(UBF_INC) { PART_INC(0) DISPATCH(); }
+      CASE(UBF_DEC) { PART_DEC(0) DISPATCH(); }
+      CASE(UBF_LT) { PART_LT(0) DISPATCH(); }
+      CASE(UBF_RT) { PART_RT(0) DISPATCH(); }
+      CASE(UBF_JZ) { PART_JZ(0) DISPATCH(); }
+      CASE(UBF_JNZ) { PART_JNZ(0) DISPATCH(); }
+      CASE(UBF_PUT) { PART_PUT(0) DISPATCH(); }
+      CASE(UBF_GET) { PART_GET(0) DISPATCH(); }
+      CASE(UBF_SET) { PART_SET(0) DISPATCH(); }
+      CASE(UBF_MUL) { PART_MUL(0) DISPATCH(); }
+      CASE(UBF_SCAN) { PART_SCAN(0) DISPATCH(); }
+      CASE(UBF_FIN) {
+        vm->ptr = ptr;
+        vm->fuel = fuel;
+        return UBF_OK;
+      }
+
+      // superinstructions, built out of the same parts
+      #define UBF_FUSED2(a, b)                              \
+        CASE(UBF_##a##_##b) {                               \
+          PART_##a(0) PART_##b(1)                           \
+          vm->pc += 1;                                      \
+          DISPATCH();                                       \
+        }
+      #define UBF_FUSED3(a, b, c)                           \
+        CASE(UBF_##a##_##b##_##c) {                         \
+          PART_##a(0) PART_##b(1) PART_##c(2)               \
+          vm->pc += 2;                                      \
+          DISPATCH();                                       \
+        }
+      UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+      #undef UBF_FUSED2
+      #undef UBF_FUSED3
+    }
+  #ifndef UBF_VM_USE_COMPUTED_GOTO
+  }
+  #endif
+
+out_of_fuel:
+  // pc is at the start of the loop, so the program can carry on from there
+  vm->ptr = ptr;
+  vm->fuel = fuel;
+  return UBF_OUT_OF_FUEL;
+halt:
+  vm->ptr = ptr;
+  vm->fuel = fuel;
+  return vm->halt;
+
+  #undef MAX
+  #undef READ
+  #undef OPERAND
+  #undef CELL
+  #undef DISPATCH
+  #undef CASE
+  #undef ADD
+  #undef JUMP
+  #undef LOOP
+  #undef PART_INC
+  #undef PART_DEC
+  #undef PART_LT
+  #undef PART_RT
+  #undef PART_JZ
+  #undef PART_JNZ
+  #undef PART_PUT
+  #undef PART_GET
+  #undef PART_SET
+  #undef PART_MUL
+  #undef PART_SCAN
+}
+
+#undef UBF_INTERP_NAME
+#undef UBF_INTERP_CELL
+#undef UBF_INTERP_SATURATE
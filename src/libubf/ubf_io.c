@@ -0,0 +1,380 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_io_c
+#define ubf_io_c
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ubf_io.h"
+
+#ifndef IOV_MAX
+# define IOV_MAX 16
+#endif
+
+bool ubf__init_io(ubf_vm_t *vm) {
+  vm->output.data = (uint8_t *)
+    ubf__allocate(&vm->arena.allocator, UBF_OUTPUT_BUFFER_SIZE);
+  vm->output.length = 0;
+  vm->output.capacity = UBF_OUTPUT_BUFFER_SIZE;
+  vm->output_pending = 0;
+
+  ubf_input_t *in = &vm->input;
+  in->initialized = false;
+  in->data = NULL;
+  in->length = 0;
+  in->position = 0;
+  in->buffer = NULL;
+  in->capacity = 0;
+  in->mapped = false;
+  in->saved_termios = NULL;
+  in->owed = 0;
+  return vm->output.data != NULL;
+}
+
+void ubf__free_io(ubf_vm_t *vm) {
+  ubf_flush(vm);
+  ubf__deallocate(&vm->arena.allocator, vm->output.data,
+                  vm->output.capacity);
+  vm->output.data = NULL;
+
+  ubf__reset_input(vm);
+  ubf__deallocate(&vm->arena.allocator, vm->input.buffer,
+                  vm->input.capacity);
+  vm->input.buffer = NULL;
+}
+
+void ubf__reset_input(ubf_vm_t *vm) {
+  ubf_input_t *in = &vm->input;
+  if (in->saved_termios != NULL) {
+    tcsetattr(vm->config.input_fd, TCSANOW, in->saved_termios);
+    ubf__deallocate(&vm->arena.allocator, in->saved_termios,
+                    sizeof(struct termios));
+    in->saved_termios = NULL;
+  }
+  if (in->mapped) {
+    // leave the file where the program stopped reading, like read would
+    lseek(vm->config.input_fd, in->position, SEEK_SET);
+    munmap((void *) in->data, in->length);
+    in->mapped = false;
+  }
+  // the buffer is kept, so it can be reused for the next input
+  in->initialized = false;
+  in->data = NULL;
+  in->length = 0;
+  in->position = 0;
+  in->owed = 0;
+}
+
+// Writes out all of the given buffers, retrying on partial writes.
+// Output that can't be written (eg. because the reading end of a pipe was
+// closed) is dropped, just like stdio would.
+size_t ubf__write_all(int fd, struct iovec *iov, int iovcnt) {
+  size_t total = 0;
+  while (iovcnt > 0) {
+    ssize_t written = writev(fd, iov, iovcnt);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    total += written;
+    while (iovcnt > 0 && (size_t) written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (uint8_t *) iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+  return total;
+}
+
+bool ubf_flush(ubf_vm_t *vm) {
+  ubf_buffer_t *out = &vm->output;
+  if (out->length == 0) return true;
+  size_t written;
+  bool full;
+  if (vm->config.write_proc != NULL) {
+    written = vm->config.write_proc(vm->config.io_context, out->data,
+                                    out->length);
+    full = written < out->length;
+  } else {
+    struct iovec iov = { out->data, out->length };
+    written = ubf__write_all(vm->config.output_fd, &iov, 1);
+    full = written < out->length
+        && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+  if (full) {
+    // the destination can't take any more, the rest is written once it drains
+    memmove(out->data, &out->data[written], out->length - written);
+    out->length -= written;
+    return false;
+  }
+  out->length = 0;
+  return true;
+}
+
+// Flushes the output buffer until it's empty, waiting for the destination to
+// drain if it's full.
+void ubf__drain(ubf_vm_t *vm) {
+  while (!ubf_flush(vm)) {
+    if (vm->config.write_proc == NULL) {
+      struct pollfd fd = { vm->config.output_fd, POLLOUT, 0 };
+      poll(&fd, 1, -1);
+    }
+  }
+}
+
+// Outputs a run too long to fit in the buffer through the write callback,
+// which takes it a buffer at a time.
+void ubf__put_long_proc(ubf_vm_t *vm, uint8_t byte, size_t amt) {
+  ubf_buffer_t *out = &vm->output;
+  ubf__drain(vm);
+  memset(out->data, byte, out->capacity);
+  while (amt != 0) {
+    out->length = (amt < out->capacity) ? amt : out->capacity;
+    amt -= out->length;
+    ubf__drain(vm);
+  }
+}
+
+// Outputs a run too long to fit in the buffer. The buffer is filled with the
+// byte and handed to writev repeatedly, so it's written out with as few
+// syscalls as possible. Whatever was buffered before stays where it is, and
+// goes out first: until it's written, the run only fills the rest of the
+// buffer.
+void ubf__put_long(ubf_vm_t *vm, uint8_t byte, size_t amt) {
+  ubf_buffer_t *out = &vm->output;
+  size_t buffered = out->length;
+  memset(&out->data[buffered], byte, out->capacity - buffered);
+
+  struct iovec iov[IOV_MAX < 64 ? IOV_MAX : 64];
+  int max_iov = sizeof(iov) / sizeof(iov[0]);
+  while (amt != 0) {
+    int iovcnt = 0;
+    if (buffered != 0) {
+      iov[iovcnt++] = (struct iovec) { out->data, buffered };
+    }
+    size_t space = out->capacity - buffered;
+    while (iovcnt < max_iov && amt != 0 && space != 0) {
+      size_t n = (amt < space) ? amt : space;
+      iov[iovcnt++] = (struct iovec) { &out->data[buffered], n };
+      amt -= n;
+    }
+    ubf__write_all(vm->config.output_fd, iov, iovcnt);
+    if (buffered != 0) {
+      memset(out->data, byte, buffered);
+      buffered = 0;
+    }
+  }
+
+  out->length = 0;
+}
+
+// Buffers output without ever writing it, for ubf_resume. What doesn't fit
+// is kept for later, and the program has to stop until the buffer's flushed.
+void ubf__put_nonblocking(ubf_vm_t *vm, uint8_t byte, size_t amt) {
+  ubf_buffer_t *out = &vm->output;
+  size_t space = out->capacity - out->length;
+  size_t n = (amt < space) ? amt : space;
+  memset(&out->data[out->length], byte, n);
+  out->length += n;
+  if (n < amt) {
+    vm->output_pending = amt - n;
+    vm->output_pending_byte = byte;
+    vm->halt = UBF_OUTPUT_READY;
+  } else if ((vm->config.flush & UBF_FLUSH_ON_NEWLINE) && byte == '\n') {
+    vm->halt = UBF_OUTPUT_READY;
+  }
+}
+
+void ubf__put_byte(ubf_vm_t *vm, uint8_t byte, int32_t amt) {
+  ubf_buffer_t *out = &vm->output;
+
+  if ((size_t) amt > vm->output_budget && vm->trap != NULL) {
+    // whatever still fits is written, so the output ends exactly at the limit
+    if (vm->output_budget != 0) {
+      ubf__put_byte(vm, byte, (int32_t) vm->output_budget);
+    }
+    longjmp(*vm->trap, UBF_OUTPUT_LIMIT);
+  }
+  vm->output_budget -= ((size_t) amt < vm->output_budget)
+                     ? (size_t) amt : vm->output_budget;
+
+  if (vm->nonblocking) {
+    ubf__put_nonblocking(vm, byte, amt);
+    return;
+  }
+
+  if ((size_t) amt > out->capacity) {
+    if (vm->config.write_proc != NULL) {
+      ubf__put_long_proc(vm, byte, amt);
+    } else {
+      ubf__put_long(vm, byte, amt);
+    }
+  } else {
+    if (out->length + amt > out->capacity) {
+      ubf__drain(vm);
+    }
+    memset(&out->data[out->length], byte, amt);
+    out->length += amt;
+  }
+
+  if ((vm->config.flush & UBF_FLUSH_ON_NEWLINE) && byte == '\n') {
+    ubf_flush(vm);
+  }
+}
+
+// Sets up input from the input file descriptor. Returns true if it's a file
+// that could be mapped, which doesn't need a buffer.
+bool ubf__init_fd_input(ubf_vm_t *vm) {
+  ubf_input_t *in = &vm->input;
+  int fd = vm->config.input_fd;
+
+  // terminals are switched to raw mode once, and restored when the VM is
+  // freed, so the program gets keys as soon as they're pressed. Without
+  // memory to save the settings in, the terminal is left as it is
+  struct termios raw;
+  if (tcgetattr(fd, &raw) == 0) {
+    in->saved_termios = (struct termios *)
+      ubf__allocate(&vm->arena.allocator, sizeof(struct termios));
+  }
+  if (in->saved_termios != NULL) {
+    *in->saved_termios = raw;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &raw);
+  }
+
+  struct stat st;
+  if (in->saved_termios == NULL && fstat(fd, &st) == 0
+      && S_ISREG(st.st_mode) && st.st_size > 0) {
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (start >= 0 && data != MAP_FAILED) {
+      #ifdef MADV_SEQUENTIAL
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      #endif
+      in->data = (const uint8_t *) data;
+      in->length = st.st_size;
+      in->position = (size_t) start < in->length ? (size_t) start : in->length;
+      in->mapped = true;
+      return true;
+    }
+    if (data != MAP_FAILED) munmap(data, st.st_size);
+  }
+  return false;
+}
+
+void ubf__init_input(ubf_vm_t *vm) {
+  ubf_input_t *in = &vm->input;
+  in->initialized = true;
+  // callbacks are always read from through the buffer
+  if (vm->config.read_proc == NULL && ubf__init_fd_input(vm)) return;
+
+  if (in->buffer == NULL) {
+    in->buffer = (uint8_t *)
+      ubf__allocate(&vm->arena.allocator, UBF_INPUT_BUFFER_SIZE);
+    if (in->buffer == NULL) {
+      // the next read tries again
+      in->initialized = false;
+      longjmp(*vm->trap, UBF_OUT_OF_MEMORY);
+    }
+    in->capacity = UBF_INPUT_BUFFER_SIZE;
+  }
+  in->data = in->buffer;
+}
+
+// Refills the input buffer. Returns false at the end of input, or in
+// ubf_resume, when there's no input yet (setting vm->halt).
+bool ubf__fill_input(ubf_vm_t *vm) {
+  ubf_input_t *in = &vm->input;
+  // a mapped file is read as a whole, there's nothing more to read
+  if (in->mapped) return false;
+
+  ssize_t readlen;
+  bool would_block;
+  if (vm->config.read_proc != NULL) {
+    readlen = vm->config.read_proc(vm->config.io_context, in->buffer,
+                                   in->capacity);
+    would_block = readlen == UBF_WOULD_BLOCK;
+  } else {
+    do {
+      readlen = read(vm->config.input_fd, in->buffer, in->capacity);
+    } while (readlen < 0 && errno == EINTR);
+    would_block = readlen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+  if (would_block && vm->nonblocking) {
+    vm->halt = UBF_NEEDS_INPUT;
+    return false;
+  }
+  if (readlen <= 0) return false;
+
+  in->length = readlen;
+  in->position = 0;
+  return true;
+}
+
+uint64_t ubf__get_value(ubf_vm_t *vm, uint64_t value, int32_t amt) {
+  ubf_input_t *in = &vm->input;
+  if ((vm->config.flush & UBF_FLUSH_ON_INPUT) && vm->output.length != 0) {
+    if (vm->nonblocking) {
+      // the prompt has to go out before anything's read
+      vm->halt = UBF_OUTPUT_READY;
+      return value;
+    }
+    ubf_flush(vm);
+  }
+  if (!in->initialized) {
+    ubf__init_input(vm);
+  }
+
+  // only the last byte read ends up in the cell, so everything before it is
+  // skipped over in bulk
+  size_t remaining = (in->owed != 0) ? in->owed : (size_t) amt;
+  in->owed = 0;
+  while (remaining > 0) {
+    if (in->position == in->length && !ubf__fill_input(vm)) {
+      if (vm->halt != UBF_OK) {
+        // the read carries on where it stopped, once it's executed again
+        in->owed = remaining;
+        return value;
+      }
+      break;
+    }
+    size_t available = in->length - in->position;
+    size_t n = (remaining < available) ? remaining : available;
+    in->position += n;
+    remaining -= n;
+    value = in->data[in->position - 1];
+  }
+
+  if (remaining > 0) {
+    switch (vm->config.eof) {
+      case UBF_EOF_MINUS_ONE: value = UINT64_MAX; break;
+      case UBF_EOF_ZERO: value = 0; break;
+      case UBF_EOF_UNCHANGED: break;
+    }
+  }
+  return value;
+}
+
+#endif
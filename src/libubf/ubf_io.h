@@ -0,0 +1,53 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_io_h
+#define ubf_io_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "ubf_brainfuck.h"
+
+/// Initializes a VM's I/O state, according to its config.
+/// Returns false if there's no memory for the output buffer.
+bool ubf__init_io(ubf_vm_t *vm);
+
+/// Flushes any pending output and frees a VM's I/O state.
+void ubf__free_io(ubf_vm_t *vm);
+
+/// Writes out all of the given buffers, retrying on partial writes.
+/// Returns the amount of bytes written, which is less than the buffers hold
+/// if writing failed.
+size_t ubf__write_all(int fd, struct iovec *iov, int iovcnt);
+
+/// Releases whatever the VM's input was set up with, so the next read sets it
+/// up again from the configured file descriptor. The input buffer is kept.
+void ubf__reset_input(ubf_vm_t *vm);
+
+/// Outputs a byte `amt` times. Used by all engines to implement PUT.
+/// In ubf_resume, sets vm->halt if the program has to stop after it.
+void ubf__put_byte(ubf_vm_t *vm, uint8_t byte, int32_t amt);
+
+/// Reads `amt` times into a cell holding `value`, and returns the cell's new
+/// value. A value of -1 sets all of the cell's bits, whatever its width. Used
+/// by all engines to implement GET.
+/// In ubf_resume, sets vm->halt if the program has to stop before it, and
+/// execute it again when it resumes.
+uint64_t ubf__get_value(ubf_vm_t *vm, uint64_t value, int32_t amt);
+
+/// Outputs an 8-bit cell `amt` times.
+static inline void ubf__put(ubf_vm_t *vm, ubf_cell_t *cell, int32_t amt) {
+  ubf__put_byte(vm, *cell, amt);
+}
+
+/// Reads into an 8-bit cell `amt` times.
+static inline void ubf__get(ubf_vm_t *vm, ubf_cell_t *cell, int32_t amt) {
+  *cell = (ubf_cell_t) ubf__get_value(vm, *cell, amt);
+}
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_ir_c
+#define ubf_ir_c
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ubf_ir.h"
+
+void ubf__init_ir(ubf_ir_t *ir, const ubf_allocator_t *allocator) {
+  ubf_init_arena(&ir->arena, allocator);
+  memset(&ir->root, 0, sizeof(ir->root));
+  ir->root.kind = UBF_IR_LOOP;
+  ir->out_of_memory = NULL;
+}
+
+void ubf__free_ir(ubf_ir_t *ir) {
+  ubf_free_arena(&ir->arena);
+}
+
+ubf_ir_node_t *ubf__ir_append(ubf_ir_t *ir, ubf_ir_node_t *loop,
+                              ubf_ir_node_kind kind) {
+  ubf_ir_node_t *node = (ubf_ir_node_t *)
+    ubf__allocate_zeroed(&ir->arena.allocator, sizeof(ubf_ir_node_t));
+  if (node == NULL) longjmp(*ir->out_of_memory, 1);
+  node->kind = kind;
+  node->parent = loop;
+  node->prev = loop->last;
+  if (loop->last != NULL) loop->last->next = node;
+  else loop->first = node;
+  loop->last = node;
+  return node;
+}
+
+// Makes room for `extra` more operations in a block.
+void ubf__ir_reserve(ubf_ir_t *ir, ubf_ir_node_t *block, size_t extra) {
+  if (block->length + extra <= block->capacity) return;
+  size_t capacity = (block->capacity < 8) ? 8 : block->capacity * 2;
+  if (capacity < block->length + extra) capacity = block->length + extra;
+  ubf_ir_op_t *ops = (ubf_ir_op_t *)
+    ubf__reallocate(&ir->arena.allocator, block->ops,
+                    block->capacity * sizeof(ubf_ir_op_t),
+                    capacity * sizeof(ubf_ir_op_t));
+  if (ops == NULL) longjmp(*ir->out_of_memory, 1);
+  block->ops = ops;
+  block->capacity = capacity;
+}
+
+void ubf__ir_push(ubf_ir_t *ir, ubf_ir_node_t *block, ubf_ir_opcode opcode,
+                  int32_t value, int32_t offset, size_t source) {
+  ubf__ir_reserve(ir, block, 1);
+  ubf_ir_op_t *op = &block->ops[block->length++];
+  op->opcode = opcode;
+  op->value = value;
+  op->offset = offset;
+  op->source = source;
+}
+
+void ubf__ir_replace_loop(ubf_ir_node_t *loop) {
+  loop->kind = UBF_IR_BLOCK;
+  loop->first = loop->last = NULL;
+  loop->length = 0;
+}
+
+void ubf__ir_remove(ubf_ir_node_t *node) {
+  if (node->prev != NULL) node->prev->next = node->next;
+  else node->parent->first = node->next;
+  if (node->next != NULL) node->next->prev = node->prev;
+  else node->parent->last = node->prev;
+}
+
+// Moves the operations of `from` to the end of `to`, and removes `from`.
+void ubf__ir_join(ubf_ir_t *ir, ubf_ir_node_t *to, ubf_ir_node_t *from) {
+  ubf__ir_reserve(ir, to, from->length);
+  memcpy(&to->ops[to->length], from->ops,
+         from->length * sizeof(ubf_ir_op_t));
+  to->length += from->length;
+  ubf__ir_remove(from);
+}
+
+ubf_ir_node_t *ubf__ir_merge(ubf_ir_t *ir, ubf_ir_node_t *block) {
+  if (block->prev != NULL && block->prev->kind == UBF_IR_BLOCK) {
+    ubf_ir_node_t *prev = block->prev;
+    ubf__ir_join(ir, prev, block);
+    block = prev;
+  }
+  if (block->next != NULL && block->next->kind == UBF_IR_BLOCK) {
+    ubf__ir_join(ir, block, block->next);
+  }
+  if (block->length == 0) {
+    ubf__ir_remove(block);
+    return (block->prev != NULL) ? block->prev : block->parent;
+  }
+  return block;
+}
+
+ubf_ir_node_t *ubf__ir_walk(const ubf_ir_t *ir, const ubf_ir_node_t *node) {
+  if (node->kind == UBF_IR_LOOP && node->first != NULL) return node->first;
+  return ubf__ir_skip(ir, node);
+}
+
+ubf_ir_node_t *ubf__ir_skip(const ubf_ir_t *ir, const ubf_ir_node_t *node) {
+  while (node != &ir->root) {
+    if (node->next != NULL) return node->next;
+    node = node->parent;
+  }
+  return NULL;
+}
+
+void ubf__ir_count(const ubf_ir_t *ir, size_t *ops, size_t *loops) {
+  *ops = *loops = 0;
+  for (const ubf_ir_node_t *node = ir->root.first; node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    if (node->kind == UBF_IR_BLOCK) *ops += node->length;
+    else (*loops)++;
+  }
+}
+
+void ubf_dump_ir(const ubf_ir_t *ir, FILE *file) {
+  static const char *names[] = {
+    [UBF_IR_ADD] = "add",   [UBF_IR_SET] = "set",   [UBF_IR_MUL] = "mul",
+    [UBF_IR_MOVE] = "move", [UBF_IR_SCAN] = "scan", [UBF_IR_PUT] = "put",
+    [UBF_IR_GET] = "get"
+  };
+  #define INDENT(depth) fprintf(file, "%*s", (int) (depth) * 2, "")
+
+  size_t depth = 0;
+  const ubf_ir_node_t *node = ir->root.first;
+  while (node != NULL) {
+    if (node->kind == UBF_IR_LOOP) {
+      INDENT(depth);
+      fprintf(file, "loop @%zu\n", node->start);
+      if (node->first != NULL) {
+        depth++;
+        node = node->first;
+        continue;
+      }
+      INDENT(depth);
+      fprintf(file, "end @%zu\n", node->end);
+    } else {
+      for (size_t i = 0; i < node->length; i++) {
+        const ubf_ir_op_t *op = &node->ops[i];
+        INDENT(depth);
+        switch (op->opcode) {
+          case UBF_IR_MOVE:
+          case UBF_IR_SCAN:
+            fprintf(file, "%-4s %+d\n", names[op->opcode], op->value);
+            break;
+          default:
+            fprintf(file, "%-4s %+d, %d\n", names[op->opcode], op->offset,
+                    op->value);
+            break;
+        }
+      }
+    }
+    // leave every loop that ends here
+    while (node->next == NULL && node->parent != &ir->root) {
+      node = node->parent;
+      depth--;
+      INDENT(depth);
+      fprintf(file, "end @%zu\n", node->end);
+    }
+    node = node->next;
+  }
+
+  #undef INDENT
+}
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_ir_h
+#define ubf_ir_h
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ubf_alloc.h"
+
+/// An operation in a basic block.
+typedef enum {
+  UBF_IR_ADD,  // adds `value` to the cell at `offset`
+  UBF_IR_SET,  // sets the cell at `offset` to `value`
+  UBF_IR_MUL,  // adds `value` times the cell at the pointer to the one at
+               // `offset`
+  UBF_IR_MOVE, // moves the pointer by `value` cells
+  UBF_IR_SCAN, // moves the pointer `value` cells at a time, until it lands on
+               // a zero
+  UBF_IR_PUT,  // writes the cell at `offset` to the output, `value` times
+  UBF_IR_GET   // reads input into the cell at `offset`, `value` times
+} ubf_ir_opcode;
+
+/// An operation. Offsets are relative to where the pointer is when the
+/// operation runs, ie. after every MOVE and SCAN before it in its block.
+typedef struct {
+  uint8_t opcode;
+  int32_t value;
+  int32_t offset;
+  // where the operation came from in the source code
+  size_t source;
+} ubf_ir_op_t;
+
+/// The kind of a node in the IR.
+typedef enum {
+  UBF_IR_BLOCK,
+  UBF_IR_LOOP
+} ubf_ir_node_kind;
+
+typedef struct ubf_ir_node_ ubf_ir_node_t;
+
+/// A node in the IR: either a basic block, a run of operations without any
+/// jumps in or out of it, or a loop, with the nodes of its body as children.
+/// The loops form a tree, and the blocks are its leaves. Two blocks are never
+/// next to each other, and blocks are never empty.
+/// The pointer is where the program expects it at the start and end of every
+/// loop's body, so every loop starts out with the pointer on the cell it
+/// checks.
+struct ubf_ir_node_ {
+  ubf_ir_node_kind kind;
+  // the loop the node is in, and the nodes before and after it in there
+  ubf_ir_node_t *parent;
+  ubf_ir_node_t *prev, *next;
+  // blocks: the operations
+  ubf_ir_op_t *ops;
+  size_t length, capacity;
+  // loops: the body
+  ubf_ir_node_t *first, *last;
+  // loops: where the [ and ] are in the source code
+  size_t start, end;
+};
+
+/// The intermediate representation of a program, which the optimizer works
+/// on between parsing and emitting bytecode.
+typedef struct {
+  // the whole program, a loop that's only ever run once; its `end` is the
+  // length of the source code
+  ubf_ir_node_t root;
+  // where the nodes and operations are allocated from, all freed together
+  ubf_arena_t arena;
+  // where to give up if the arena runs out of memory
+  jmp_buf *out_of_memory;
+} ubf_ir_t;
+
+/// Initializes an empty IR, whose memory comes from `allocator`.
+void ubf__init_ir(ubf_ir_t *ir, const ubf_allocator_t *allocator);
+
+/// Frees an IR and all of its nodes.
+void ubf__free_ir(ubf_ir_t *ir);
+
+/// Appends a new, empty node to the end of a loop's body.
+/// Like every function that adds to the IR, jumps to ir->out_of_memory if it
+/// runs out of memory.
+ubf_ir_node_t *ubf__ir_append(ubf_ir_t *ir, ubf_ir_node_t *loop,
+                              ubf_ir_node_kind kind);
+
+/// Appends an operation to a block.
+void ubf__ir_push(ubf_ir_t *ir, ubf_ir_node_t *block, ubf_ir_opcode opcode,
+                  int32_t value, int32_t offset, size_t source);
+
+/// Turns a loop into an empty block, for the operations it's replaced with.
+void ubf__ir_replace_loop(ubf_ir_node_t *loop);
+
+/// Removes a node from its loop.
+void ubf__ir_remove(ubf_ir_node_t *node);
+
+/// Merges a block with the blocks next to it, and removes it if it's left
+/// empty, so no two blocks end up next to each other. Returns the block the
+/// operations ended up in, or the node before the removed block (which may be
+/// its loop).
+ubf_ir_node_t *ubf__ir_merge(ubf_ir_t *ir, ubf_ir_node_t *block);
+
+/// Returns the node after `node` in program order: the first node of its body
+/// if it's a loop, otherwise the node after it or after the innermost loop
+/// that has one. Returns NULL at the end of the program.
+ubf_ir_node_t *ubf__ir_walk(const ubf_ir_t *ir, const ubf_ir_node_t *node);
+
+/// Returns the node after `node` and its body in program order, like
+/// ubf__ir_walk but without going into loops.
+ubf_ir_node_t *ubf__ir_skip(const ubf_ir_t *ir, const ubf_ir_node_t *node);
+
+/// Returns the IR's first node, or NULL if the program is empty.
+static inline ubf_ir_node_t *ubf__ir_first(ubf_ir_t *ir) {
+  return ir->root.first;
+}
+
+/// Counts the operations and loops in an IR.
+void ubf__ir_count(const ubf_ir_t *ir, size_t *ops, size_t *loops);
+
+/// Writes a readable listing of an IR to a file, loops indented by how deep
+/// they're nested.
+void ubf_dump_ir(const ubf_ir_t *ir, FILE *file);
+
+#endif
@@ -0,0 +1,437 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_jit_c
+#define ubf_jit_c
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ubf_io.h"
+#include "ubf_jit.h"
+#include "ubf_tape.h"
+
+#ifdef UBF_VM_USE_JIT
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// The JIT translates every instruction of a chunk to x86-64 machine code,
+// following the System V calling convention. The generated function has the
+// signature:
+//
+//   ubf_interpret_result fn(ubf_vm_t *vm, ubf_cell_t *ptr,
+//                           const uint8_t *entry);
+//
+// starts running at `entry`, the native code of the instruction at vm->pc,
+// and stores the pointer, the fuel, and (unless the program finished) the pc
+// it stopped at back in the VM. While it runs, these callee-saved registers
+// hold the VM's state:
+//  - rbx: the pointer,
+//  - r12: the VM,
+//  - r13: the fuel,
+//  - r14: the lowest address the pointer can be at while keeping its margin,
+//  - r15: the highest address the pointer can be at while keeping its margin.
+// Anything that can't be done inline (I/O, growing the tape, scanning) is done
+// by calling back into C.
+
+// the generated code only ever works on byte cells
+_Static_assert(sizeof(ubf_cell_t) == 1, "the JIT needs 8-bit cells");
+
+struct ubf_jit_code_ {
+  const ubf_allocator_t *allocator;
+  uint8_t *code;
+  size_t length;
+  // the offset of every instruction's native code, where a program stopped
+  // by ubf_resume picks up
+  size_t *entries;
+  size_t entry_count;
+};
+
+typedef ubf_interpret_result (*ubf__jit_fn)(ubf_vm_t *vm, ubf_cell_t *ptr,
+                                            const uint8_t *entry);
+
+// Jumps to one of the code's exits, patched once the exit is emitted.
+typedef struct {
+  size_t *patches;
+  size_t count;
+} ubf__jit_exits_t;
+
+typedef struct {
+  uint8_t *code;
+  size_t length;
+  size_t capacity;
+  const ubf_allocator_t *allocator;
+  // where to give up if the buffer can't grow
+  jmp_buf *out_of_memory;
+} ubf__jit_buffer_t;
+
+ubf_cell_t *ubf__jit_move(ubf_vm_t *vm, ubf_cell_t *ptr, int64_t amount) {
+  return ubf__tape_move(vm, ptr, amount);
+}
+
+ubf_cell_t *ubf__jit_scan(ubf_vm_t *vm, ubf_cell_t *ptr, int32_t stride) {
+  return ubf__tape_scan(vm, ptr, stride);
+}
+
+void ubf__jit_put(ubf_vm_t *vm, ubf_cell_t *cell, int32_t amt) {
+  ubf__put(vm, cell, amt);
+}
+
+void ubf__jit_get(ubf_vm_t *vm, ubf_cell_t *cell, int32_t amt) {
+  ubf__get(vm, cell, amt);
+}
+
+void ubf__jit_emit(ubf__jit_buffer_t *buf, const uint8_t *bytes, size_t n) {
+  if (buf->capacity < buf->length + n) {
+    size_t capacity = (buf->capacity < 256) ? 256 : buf->capacity * 2;
+    while (capacity < buf->length + n) capacity *= 2;
+    uint8_t *code = (uint8_t *)
+      ubf__reallocate(buf->allocator, buf->code, buf->capacity, capacity);
+    if (code == NULL) {
+      ubf__deallocate(buf->allocator, buf->code, buf->capacity);
+      longjmp(*buf->out_of_memory, 1);
+    }
+    buf->code = code;
+    buf->capacity = capacity;
+  }
+  memcpy(&buf->code[buf->length], bytes, n);
+  buf->length += n;
+}
+
+void ubf__jit_emit32(ubf__jit_buffer_t *buf, int32_t value) {
+  uint8_t bytes[4];
+  memcpy(bytes, &value, 4);
+  ubf__jit_emit(buf, bytes, 4);
+}
+
+void ubf__jit_emit64(ubf__jit_buffer_t *buf, uint64_t value) {
+  uint8_t bytes[8];
+  memcpy(bytes, &value, 8);
+  ubf__jit_emit(buf, bytes, 8);
+}
+
+#define EMIT(...) \
+  do { \
+    const uint8_t bytes_[] = { __VA_ARGS__ }; \
+    ubf__jit_emit(buf, bytes_, sizeof(bytes_)); \
+  } while (false)
+
+// Emits a call to a C function. The arguments have to be set up already.
+void ubf__jit_emit_call(ubf__jit_buffer_t *buf, void *fn) {
+  EMIT(0x48, 0xb8);                         // mov rax, imm64
+  ubf__jit_emit64(buf, (uint64_t)(uintptr_t) fn);
+  EMIT(0xff, 0xd0);                         // call rax
+}
+
+// Recomputes r14 and r15 after the tape might've been reallocated.
+void ubf__jit_emit_load_bounds(ubf__jit_buffer_t *buf) {
+  EMIT(0x4d, 0x8b, 0xb4, 0x24);             // mov r14, [r12 + cells]
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, tape) + offsetof(ubf_tape_t, cells));
+  EMIT(0x4d, 0x8b, 0xbc, 0x24);             // mov r15, [r12 + length]
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, tape) + offsetof(ubf_tape_t, length));
+  EMIT(0x4f, 0x8d, 0xbc, 0x3e);             // lea r15, [r14 + r15 - 1 - margin]
+  ubf__jit_emit32(buf, -1 - UBF_TAPE_MARGIN);
+  EMIT(0x49, 0x81, 0xc6);                   // add r14, margin
+  ubf__jit_emit32(buf, UBF_TAPE_MARGIN);
+}
+
+// Stores the VM's state back, and returns whatever's in eax.
+void ubf__jit_emit_exit(ubf__jit_buffer_t *buf) {
+  EMIT(0x4d, 0x89, 0xac, 0x24);             // mov [r12 + fuel], r13
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, fuel));
+  EMIT(0x49, 0x89, 0x9c, 0x24);             // mov [r12 + ptr], rbx
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, ptr));
+  EMIT(0x41, 0x5f);                         // pop r15
+  EMIT(0x41, 0x5e);                         // pop r14
+  EMIT(0x41, 0x5d);                         // pop r13
+  EMIT(0x41, 0x5c);                         // pop r12
+  EMIT(0x5b);                               // pop rbx
+  EMIT(0xc3);                               // ret
+}
+
+// Emits a jump to one of the exits, stopping the program so that it resumes
+// at the instruction `pc`.
+void ubf__jit_emit_stop(ubf__jit_buffer_t *buf, size_t pc,
+                        ubf__jit_exits_t *exits) {
+  EMIT(0x49, 0xc7, 0x84, 0x24);             // mov qword [r12 + pc], pc
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, pc));
+  ubf__jit_emit32(buf, (int32_t) pc);
+  EMIT(0xe9);                               // jmp .exit
+  exits->patches[exits->count++] = buf->length;
+  ubf__jit_emit32(buf, 0);
+}
+
+// Points the jumps to one of the exits at the current position.
+void ubf__jit_patch_exits(ubf__jit_buffer_t *buf, ubf__jit_exits_t *exits) {
+  for (size_t i = 0; i < exits->count; i++) {
+    int32_t rel = (int32_t)(buf->length - (exits->patches[i] + 4));
+    memcpy(&buf->code[exits->patches[i]], &rel, 4);
+  }
+}
+
+void ubf__jit_emit_move(ubf__jit_buffer_t *buf, int32_t amount) {
+  EMIT(0x48, 0x8d, 0x83);                   // lea rax, [rbx + amount]
+  ubf__jit_emit32(buf, amount);
+  if (amount > 0) {
+    EMIT(0x4c, 0x39, 0xf8);                 // cmp rax, r15
+    EMIT(0x76, 0);                          // jbe .in_bounds
+  } else {
+    EMIT(0x4c, 0x39, 0xf0);                 // cmp rax, r14
+    EMIT(0x73, 0);                          // jae .in_bounds
+  }
+  size_t jump = buf->length;
+  EMIT(0x4c, 0x89, 0xe7);                   // mov rdi, r12
+  EMIT(0x48, 0x89, 0xde);                   // mov rsi, rbx
+  EMIT(0x48, 0xc7, 0xc2);                   // mov rdx, amount
+  ubf__jit_emit32(buf, amount);
+  ubf__jit_emit_call(buf, (void *) ubf__jit_move);
+  ubf__jit_emit_load_bounds(buf);
+  buf->code[jump - 1] = (uint8_t)(buf->length - jump);
+  // .in_bounds:
+  EMIT(0x48, 0x89, 0xc3);                   // mov rbx, rax
+}
+
+// Emits a call to an I/O function operating on the cell at `offset`. If the
+// call sets vm->halt, the program stops, and resumes at the instruction
+// `resume`.
+void ubf__jit_emit_io(ubf__jit_buffer_t *buf, void *fn,
+                      int32_t offset, int32_t amt,
+                      size_t resume, ubf__jit_exits_t *halts) {
+  EMIT(0x4c, 0x89, 0xe7);                   // mov rdi, r12
+  EMIT(0x48, 0x8d, 0xb3);                   // lea rsi, [rbx + offset]
+  ubf__jit_emit32(buf, offset);
+  EMIT(0xba);                               // mov edx, amt
+  ubf__jit_emit32(buf, amt);
+  ubf__jit_emit_call(buf, fn);
+  EMIT(0x41, 0x83, 0xbc, 0x24);             // cmp dword [r12 + halt], 0
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, halt));
+  EMIT(0x00);
+  EMIT(0x74, 0);                            // je .go_on
+  size_t skip = buf->length;
+  ubf__jit_emit_stop(buf, resume, halts);
+  buf->code[skip - 1] = (uint8_t)(buf->length - skip);
+  // .go_on:
+}
+
+ubf_jit_code_t *ubf__jit_compile(ubf_chunk_t *chunk,
+                                 const ubf_allocator_t *allocator) {
+  // if the buffer can't grow, emitting frees it and longjmps back here,
+  // leaving only the tables to free
+  jmp_buf trap;
+  ubf__jit_buffer_t buffer = { NULL, 0, 0, allocator, &trap };
+  ubf__jit_buffer_t *buf = &buffer;
+  size_t table_size = (chunk->length + 1) * sizeof(size_t);
+  // native offset of every instruction, and of the rel32 of every jump
+  size_t *native = (size_t *) ubf__allocate(allocator, table_size);
+  size_t *patches = (size_t *) ubf__allocate(allocator, table_size);
+  // jumps to the exits taken when the fuel runs out, and when I/O halts
+  size_t *fuel_patches = (size_t *) ubf__allocate(allocator, table_size);
+  size_t *halt_patches = (size_t *) ubf__allocate(allocator, table_size);
+  if (native == NULL || patches == NULL
+      || fuel_patches == NULL || halt_patches == NULL) {
+    goto out_of_memory;
+  }
+  if (setjmp(trap) != 0) goto out_of_memory;
+  ubf__jit_exits_t fuel_exits = { fuel_patches, 0 };
+  ubf__jit_exits_t halt_exits = { halt_patches, 0 };
+
+  EMIT(0x53);                               // push rbx
+  EMIT(0x41, 0x54);                         // push r12
+  EMIT(0x41, 0x55);                         // push r13
+  EMIT(0x41, 0x56);                         // push r14
+  EMIT(0x41, 0x57);                         // push r15
+  EMIT(0x49, 0x89, 0xfc);                   // mov r12, rdi
+  EMIT(0x48, 0x89, 0xf3);                   // mov rbx, rsi
+  EMIT(0x4d, 0x8b, 0xac, 0x24);             // mov r13, [r12 + fuel]
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, fuel));
+  ubf__jit_emit_load_bounds(buf);
+  EMIT(0xff, 0xe2);                         // jmp rdx
+
+  for (size_t i = 0; i < chunk->length; i++) {
+    ubf_instr_t *instr = &chunk->code[i];
+    native[i] = buf->length;
+    patches[i] = 0;
+    // superinstructions only save dispatches, which native code doesn't have,
+    // so each instruction is compiled on its own
+    ubf_opcode opcode = ubf__base_opcode(instr->opcode);
+    switch (opcode) {
+      case UBF_INC:
+        EMIT(0x80, 0x83);                   // add byte [rbx + offset], imm8
+        ubf__jit_emit32(buf, instr->offset);
+        EMIT((uint8_t) instr->operand);
+        break;
+      case UBF_DEC:
+        EMIT(0x80, 0xab);                   // sub byte [rbx + offset], imm8
+        ubf__jit_emit32(buf, instr->offset);
+        EMIT((uint8_t) instr->operand);
+        break;
+      case UBF_SET:
+        EMIT(0xc6, 0x83);                   // mov byte [rbx + offset], imm8
+        ubf__jit_emit32(buf, instr->offset);
+        EMIT((uint8_t) instr->operand);
+        break;
+      case UBF_MUL:
+        EMIT(0x0f, 0xb6, 0x03);             // movzx eax, byte [rbx]
+        EMIT(0x69, 0xc0);                   // imul eax, eax, imm32
+        ubf__jit_emit32(buf, instr->operand);
+        EMIT(0x00, 0x83);                   // add [rbx + offset], al
+        ubf__jit_emit32(buf, instr->offset);
+        break;
+      case UBF_LT:
+        ubf__jit_emit_move(buf, -instr->operand);
+        break;
+      case UBF_RT:
+        ubf__jit_emit_move(buf, instr->operand);
+        break;
+      case UBF_SCAN:
+        EMIT(0x4c, 0x89, 0xe7);             // mov rdi, r12
+        EMIT(0x48, 0x89, 0xde);             // mov rsi, rbx
+        EMIT(0xba);                         // mov edx, stride
+        ubf__jit_emit32(buf, instr->operand);
+        ubf__jit_emit_call(buf, (void *) ubf__jit_scan);
+        EMIT(0x48, 0x89, 0xc3);             // mov rbx, rax
+        ubf__jit_emit_load_bounds(buf);
+        break;
+      case UBF_JZ:
+        EMIT(0x80, 0x3b, 0x00);             // cmp byte [rbx], 0
+        EMIT(0x0f, 0x84);                   // je rel32
+        patches[i] = buf->length;
+        ubf__jit_emit32(buf, 0);
+        break;
+      case UBF_JNZ: {
+        // the loop's fuel is only charged when it repeats
+        int32_t cost = -instr->operand;
+        EMIT(0x80, 0x3b, 0x00);             // cmp byte [rbx], 0
+        EMIT(0x74, 0);                      // je .done
+        size_t skip = buf->length;
+        EMIT(0x49, 0x81, 0xed);             // sub r13, cost
+        ubf__jit_emit32(buf, cost);
+        EMIT(0x0f, 0x83);                   // jae rel32
+        patches[i] = buf->length;
+        ubf__jit_emit32(buf, 0);
+        // out of fuel: give the fuel back, and stop at the start of the loop
+        EMIT(0x49, 0x81, 0xc5);             // add r13, cost
+        ubf__jit_emit32(buf, cost);
+        ubf__jit_emit_stop(buf, i + 1 + instr->operand, &fuel_exits);
+        buf->code[skip - 1] = (uint8_t)(buf->length - skip);
+        // .done:
+        break;
+      }
+      // output stops after it's done, input before it's executed again
+      case UBF_PUT:
+        ubf__jit_emit_io(buf, (void *) ubf__jit_put,
+                         instr->offset, instr->operand, i + 1, &halt_exits);
+        break;
+      case UBF_GET:
+        ubf__jit_emit_io(buf, (void *) ubf__jit_get,
+                         instr->offset, instr->operand, i, &halt_exits);
+        break;
+      case UBF_FIN:
+        EMIT(0x31, 0xc0);                   // xor eax, eax (UBF_OK)
+        ubf__jit_emit_exit(buf);
+        break;
+      default:
+        break;
+    }
+  }
+  native[chunk->length] = buf->length;
+
+  // .out_of_fuel:
+  ubf__jit_patch_exits(buf, &fuel_exits);
+  EMIT(0xb8);                               // mov eax, UBF_OUT_OF_FUEL
+  ubf__jit_emit32(buf, UBF_OUT_OF_FUEL);
+  ubf__jit_emit_exit(buf);
+  // .halt:
+  ubf__jit_patch_exits(buf, &halt_exits);
+  EMIT(0x41, 0x8b, 0x84, 0x24);             // mov eax, [r12 + halt]
+  ubf__jit_emit32(buf, offsetof(ubf_vm_t, halt));
+  ubf__jit_emit_exit(buf);
+
+  // bytecode jumps are relative to the next instruction, and so are x86's
+  for (size_t i = 0; i < chunk->length; i++) {
+    if (patches[i] == 0) continue;
+    size_t target = native[i + 1 + chunk->code[i].operand];
+    int32_t rel = (int32_t)(target - (patches[i] + 4));
+    memcpy(&buf->code[patches[i]], &rel, 4);
+  }
+  ubf__deallocate(allocator, patches, table_size);
+  ubf__deallocate(allocator, fuel_patches, table_size);
+  ubf__deallocate(allocator, halt_patches, table_size);
+
+  // the code is written while the mapping is writable, and only then made
+  // executable, so it's never both at once
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  size_t length = (buf->length + page - 1) / page * page;
+  void *code = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    ubf__deallocate(allocator, buf->code, buf->capacity);
+    ubf__deallocate(allocator, native, table_size);
+    return NULL;
+  }
+  memcpy(code, buf->code, buf->length);
+  ubf__deallocate(allocator, buf->code, buf->capacity);
+  ubf_jit_code_t *jit = (ubf_jit_code_t *)
+    ubf__allocate(allocator, sizeof(ubf_jit_code_t));
+  if (jit == NULL || mprotect(code, length, PROT_READ | PROT_EXEC) != 0) {
+    ubf__deallocate(allocator, jit, sizeof(ubf_jit_code_t));
+    munmap(code, length);
+    ubf__deallocate(allocator, native, table_size);
+    return NULL;
+  }
+
+  jit->allocator = allocator;
+  jit->code = (uint8_t *) code;
+  jit->length = length;
+  jit->entries = native;
+  jit->entry_count = chunk->length + 1;
+  return jit;
+
+out_of_memory:
+  ubf__deallocate(allocator, native, table_size);
+  ubf__deallocate(allocator, patches, table_size);
+  ubf__deallocate(allocator, fuel_patches, table_size);
+  ubf__deallocate(allocator, halt_patches, table_size);
+  return NULL;
+}
+
+#undef EMIT
+
+void ubf__jit_free(ubf_jit_code_t *code) {
+  const ubf_allocator_t *allocator = code->allocator;
+  munmap(code->code, code->length);
+  ubf__deallocate(allocator, code->entries,
+                  code->entry_count * sizeof(size_t));
+  ubf__deallocate(allocator, code, sizeof(ubf_jit_code_t));
+}
+
+ubf_interpret_result ubf__jit_run(ubf_vm_t *vm, ubf_jit_code_t *code) {
+  ubf__jit_fn fn;
+  // ISO C doesn't allow converting object pointers to function pointers
+  memcpy(&fn, &code->code, sizeof(fn));
+  return fn(vm, vm->ptr, &code->code[code->entries[vm->pc]]);
+}
+
+#else
+
+ubf_jit_code_t *ubf__jit_compile(ubf_chunk_t *chunk,
+                                 const ubf_allocator_t *allocator) {
+  return NULL;
+}
+
+void ubf__jit_free(ubf_jit_code_t *code) {}
+
+ubf_interpret_result ubf__jit_run(ubf_vm_t *vm, ubf_jit_code_t *code) {
+  return UBF_OK;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_jit_h
+#define ubf_jit_h
+
+#include <stdbool.h>
+
+#include "ubf_brainfuck.h"
+#include "ubf_compiler.h"
+
+/// A chunk of bytecode, compiled to native code.
+typedef struct ubf_jit_code_ ubf_jit_code_t;
+
+/// Compiles a chunk of bytecode to native code. Everything but the native code
+/// itself, which is mapped on its own pages, comes from `allocator`.
+/// Returns NULL if the JIT isn't supported on this platform, or if the code
+/// couldn't be allocated. The chunk should be interpreted instead then.
+ubf_jit_code_t *ubf__jit_compile(ubf_chunk_t *chunk,
+                                 const ubf_allocator_t *allocator);
+
+/// Frees previously compiled native code.
+void ubf__jit_free(ubf_jit_code_t *code);
+
+/// Runs compiled native code in a VM.
+ubf_interpret_result ubf__jit_run(ubf_vm_t *vm, ubf_jit_code_t *code);
+
+#endif
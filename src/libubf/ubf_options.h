@@ -7,9 +7,35 @@
 #ifndef ubf_options_h
 #define ubf_options_h
 
-/// The underlying data type for memory cells.
-/// Must be a number that can be incremented and decremented using ++ and --.
-#define UBF_MEM_TYPE int8_t
+/// The amount of cells allocated for a fresh tape.
+/// The tape is grown automatically, this only affects how soon that happens.
+#define UBF_TAPE_INITIAL_LENGTH 4096
+
+/// The amount of cells that are always kept allocated on both sides of the
+/// pointer. Instructions can access cells this far from the pointer without
+/// checking the tape's bounds.
+#define UBF_TAPE_MARGIN 256
+
+/// The fewest cells a tape can have: the pointer's cell and its margins.
+/// A VM can't be limited to a shorter tape.
+#define UBF_TAPE_MIN_LENGTH (2 * UBF_TAPE_MARGIN + 1)
+
+/// The size of a VM's output buffer, in bytes.
+#define UBF_OUTPUT_BUFFER_SIZE 65536
+
+/// The size of a VM's input buffer, in bytes.
+/// This doesn't apply to input from regular files, which is mapped into memory.
+#define UBF_INPUT_BUFFER_SIZE 65536
+
+/// The most jobs of an ordered batch that may hold on to their finished output
+/// while an earlier job is still running. Every such job keeps a temporary file
+/// open, so this bounds the amount of files a batch has open at once.
+#define UBF_BATCH_MAX_PENDING 64
+
+/// The smallest block of memory an arena allocates from its backing allocator,
+/// in bytes. A VM's arena holds its tape and I/O buffers, so this is enough
+/// for most programs to never need a second block.
+#define UBF_ARENA_BLOCK_SIZE 262144
 
 /// Set this to 0 if you're compiling onto a platform without stdio.
 #define UBF_USE_STDIO 1
@@ -17,6 +43,22 @@
 /// Set to 0 if you don't want to use computed gotos.
 #define UBF_USE_COMPUTED_GOTO 1
 
+/// Set to 0 if you don't want the tail-call-threaded engine to be built.
+/// The engine relies on every handler tail-calling the next one, so it's only
+/// available with compilers that support `musttail`, or in optimized builds
+/// with GCC, which turns the calls into jumps on its own. Elsewhere, VMs
+/// configured to use it fall back to the direct-threaded engine.
+#define UBF_USE_TAIL_CALLS 1
+
+/// Set to 0 if you don't want to use SIMD instructions for scanning the tape
+/// and skipping over comments in source code.
+#define UBF_USE_SIMD 1
+
+/// Set to 0 if you don't want the JIT compiler to be built.
+/// The JIT is only available on x86-64 Unix-like systems; elsewhere, VMs
+/// configured to use it fall back to the interpreter.
+#define UBF_USE_JIT 1
+
 /* -------------------------------------------------------------------------- */
 /* INTERNAL FLAGS - DO NOT MODIFY DIRECTLY                                    */
 /* -------------------------------------------------------------------------- */
@@ -33,4 +75,30 @@
 # define UBF_VM_USE_CASE_STMT
 #endif
 
+#if defined(__has_attribute)
+# if __has_attribute(musttail)
+#  define UBF_VM_SUPPORT_MUSTTAIL
+# endif
+#endif
+
+#if defined(UBF_VM_SUPPORT_MUSTTAIL)
+# define UBF_VM_MUSTTAIL __attribute__((musttail))
+#else
+# define UBF_VM_MUSTTAIL
+#endif
+
+#if UBF_USE_TAIL_CALLS && (defined(UBF_VM_SUPPORT_MUSTTAIL) \
+                           || (defined(__GNUC__) && defined(__OPTIMIZE__)))
+# define UBF_VM_USE_TAIL_CALLS
+#endif
+
+#if defined(__SSE2__) && UBF_USE_SIMD
+# define UBF_TAPE_USE_SSE2
+# define UBF_COMPILER_USE_SSE2
+#endif
+
+#if defined(__x86_64__) && defined(__unix__) && UBF_USE_JIT
+# define UBF_VM_USE_JIT
+#endif
+
 #endif
@@ -0,0 +1,636 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_passes_c
+#define ubf_passes_c
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ubf_options.h"
+#include "ubf_passes.h"
+
+// Every pass walks the whole IR once, and returns how many changes it made.
+// Passes that replace or remove loops merge the blocks around them right
+// away, so the next pass always sees alternating blocks and loops.
+
+// Returns a loop's body if it's a single block, NULL otherwise.
+ubf_ir_node_t *ubf__loop_body(ubf_ir_node_t *loop) {
+  ubf_ir_node_t *body = loop->first;
+  if (body == NULL || body != loop->last || body->kind != UBF_IR_BLOCK) {
+    return NULL;
+  }
+  return body;
+}
+
+// Replaces a loop with a single operation, and merges it into the blocks
+// around it. Returns the block it ended up in.
+ubf_ir_node_t *ubf__replace_with(ubf_ir_t *ir, ubf_ir_node_t *loop,
+                                 ubf_ir_opcode opcode, int32_t value) {
+  size_t source = loop->start;
+  ubf__ir_replace_loop(loop);
+  ubf__ir_push(ir, loop, opcode, value, 0, source);
+  return ubf__ir_merge(ir, loop);
+}
+
+// Clear loops, `[-]`, are replaced with `SET 0`. Instead of looping up to 255
+// times, the cell is zeroed with a single instruction. The body may move
+// around, as long as it changes nothing but the cell it started at, which it
+// decrements by 1. `[+]` is left alone: on saturating cells, it never ends.
+size_t ubf__clear_loops(ubf_ir_t *ir) {
+  size_t changes = 0;
+  for (ubf_ir_node_t *node = ubf__ir_first(ir); node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    ubf_ir_node_t *body;
+    if (node->kind != UBF_IR_LOOP || (body = ubf__loop_body(node)) == NULL) {
+      continue;
+    }
+    int64_t offset = 0;
+    size_t adds = 0;
+    bool clear = true;
+    for (size_t i = 0; i < body->length && clear; i++) {
+      const ubf_ir_op_t *op = &body->ops[i];
+      if (op->opcode == UBF_IR_MOVE) {
+        offset += op->value;
+      } else {
+        adds++;
+        clear = op->opcode == UBF_IR_ADD && offset + op->offset == 0
+             && op->value == -1;
+      }
+    }
+    if (!clear || adds != 1 || offset != 0) continue;
+    node = ubf__replace_with(ir, node, UBF_IR_SET, 0);
+    changes++;
+  }
+  return changes;
+}
+
+// Multiplication loops only add to cells, end up at the cell they started at,
+// and decrement that cell by exactly 1, eg. `[->+>++<<]`. Loops that
+// increment it instead never end on saturating cells, so they're left alone,
+// like `[+]` is. Each cell may only be
+// added to or subtracted from, not both, or saturating cells would end up
+// with something else. Such a loop runs as
+// many times as the value of its starting cell, so it's replaced with a MUL
+// for every other cell it touches, followed by a SET 0. Loops which reach
+// further than the tape's margin, or touch too many cells, are left as they
+// are.
+size_t ubf__mul_loops(ubf_ir_t *ir) {
+  #define MAX_TARGETS 16
+
+  size_t changes = 0;
+  for (ubf_ir_node_t *node = ubf__ir_first(ir); node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    ubf_ir_node_t *body;
+    if (node->kind != UBF_IR_LOOP || (body = ubf__loop_body(node)) == NULL) {
+      continue;
+    }
+
+    int32_t offsets[MAX_TARGETS + 1];
+    uint32_t deltas[MAX_TARGETS + 1];
+    // a bit for adding, and one for subtracting
+    uint8_t signs[MAX_TARGETS + 1];
+    size_t ntargets = 1;
+    offsets[0] = 0;
+    deltas[0] = 0;
+    signs[0] = 0;
+    int64_t offset = 0;
+    bool mul = true;
+    for (size_t i = 0; i < body->length && mul; i++) {
+      const ubf_ir_op_t *op = &body->ops[i];
+      if (op->opcode == UBF_IR_MOVE) {
+        offset += op->value;
+        continue;
+      }
+      int64_t cell = offset + op->offset;
+      if (op->opcode != UBF_IR_ADD
+          || cell < -UBF_TAPE_MARGIN || cell > UBF_TAPE_MARGIN) {
+        mul = false;
+        break;
+      }
+      size_t t = 0;
+      while (t < ntargets && offsets[t] != cell) t++;
+      if (t == ntargets) {
+        if (ntargets > MAX_TARGETS) {
+          mul = false;
+          break;
+        }
+        offsets[t] = (int32_t) cell;
+        deltas[t] = 0;
+        signs[t] = 0;
+        ntargets++;
+      }
+      deltas[t] += (uint32_t) op->value;
+      signs[t] |= (op->value > 0) ? 1 : 2;
+      mul = signs[t] != 3;
+    }
+    if (!mul || offset != 0) continue;
+
+    // the loop runs `value` times
+    if (deltas[0] != (uint32_t) -1) continue;
+
+    size_t source = node->start;
+    ubf__ir_replace_loop(node);
+    for (size_t t = 1; t < ntargets; t++) {
+      if (deltas[t] == 0) continue;
+      ubf__ir_push(ir, node, UBF_IR_MUL, (int32_t) deltas[t],
+                   offsets[t], source);
+    }
+    ubf__ir_push(ir, node, UBF_IR_SET, 0, 0, source);
+    node = ubf__ir_merge(ir, node);
+    changes++;
+  }
+  return changes;
+
+  #undef MAX_TARGETS
+}
+
+// Scan loops, like `[>]`, `[<]`, or `[>>>]`, only move the pointer, so they're
+// replaced with a SCAN with the loop's stride. The VM searches the tape for a
+// zero cell directly, instead of dispatching three instructions for every cell
+// it passes.
+size_t ubf__scan_loops(ubf_ir_t *ir) {
+  size_t changes = 0;
+  for (ubf_ir_node_t *node = ubf__ir_first(ir); node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    ubf_ir_node_t *body;
+    if (node->kind != UBF_IR_LOOP || (body = ubf__loop_body(node)) == NULL) {
+      continue;
+    }
+    int64_t stride = 0;
+    size_t i = 0;
+    while (i < body->length && body->ops[i].opcode == UBF_IR_MOVE) {
+      stride += body->ops[i++].value;
+    }
+    if (i < body->length || stride == 0
+        || stride < -INT32_MAX || stride > INT32_MAX) {
+      continue;
+    }
+    node = ubf__replace_with(ir, node, UBF_IR_SCAN, (int32_t) stride);
+    changes++;
+  }
+  return changes;
+}
+
+// A loop that starts on a cell that's known to be zero is never entered, which
+// is the case right after another loop (no matter what it did, it only ended
+// because its cell was zero), and right after the cell was set to zero.
+// Generated code often has those, eg. a clear loop after a loop that already
+// cleared the cell.
+size_t ubf__dead_loops(ubf_ir_t *ir) {
+  size_t changes = 0;
+  ubf_ir_node_t *node = ubf__ir_first(ir);
+  while (node != NULL) {
+    ubf_ir_node_t *prev = node->prev;
+    bool dead = false;
+    if (node->kind == UBF_IR_LOOP && prev != NULL) {
+      if (prev->kind == UBF_IR_LOOP) {
+        dead = true;
+      } else {
+        const ubf_ir_op_t *last = &prev->ops[prev->length - 1];
+        dead = last->opcode == UBF_IR_SET && last->value == 0
+            && last->offset == 0;
+      }
+    }
+    if (!dead) {
+      node = ubf__ir_walk(ir, node);
+      continue;
+    }
+    // the code after the loop continues right where the code before it ended
+    ubf_ir_node_t *next = ubf__ir_skip(ir, node);
+    ubf__ir_remove(node);
+    if (prev->kind == UBF_IR_BLOCK && prev->next == next && next != NULL
+        && next->kind == UBF_IR_BLOCK) {
+      next = ubf__ir_skip(ir, next);
+      ubf__ir_merge(ir, prev);
+    }
+    node = next;
+    changes++;
+  }
+  return changes;
+}
+
+// Values of cells that are known within a block. Only a few are kept track
+// of, which is enough for the cells a block is working on at the moment.
+#define UBF_KNOWN_CELLS 16
+typedef struct {
+  int64_t cells[UBF_KNOWN_CELLS];
+  int32_t values[UBF_KNOWN_CELLS];
+  size_t count;
+} ubf__known_t;
+
+// Returns where a cell's value is in the table, or -1 if it's not known.
+int ubf__known_find(const ubf__known_t *known, int64_t cell) {
+  for (size_t i = 0; i < known->count; i++) {
+    if (known->cells[i] == cell) return (int) i;
+  }
+  return -1;
+}
+
+void ubf__known_forget(ubf__known_t *known, int64_t cell) {
+  int i = ubf__known_find(known, cell);
+  if (i < 0) return;
+  known->count--;
+  known->cells[i] = known->cells[known->count];
+  known->values[i] = known->values[known->count];
+}
+
+void ubf__known_set(ubf__known_t *known, int64_t cell, int32_t value) {
+  int i = ubf__known_find(known, cell);
+  if (i < 0) {
+    // the table is full, so the oldest cell is the first one in it
+    if (known->count == UBF_KNOWN_CELLS) {
+      memmove(&known->cells[0], &known->cells[1],
+              (UBF_KNOWN_CELLS - 1) * sizeof(known->cells[0]));
+      memmove(&known->values[0], &known->values[1],
+              (UBF_KNOWN_CELLS - 1) * sizeof(known->values[0]));
+      known->count--;
+    }
+    i = (int) known->count++;
+    known->cells[i] = cell;
+  }
+  known->values[i] = value;
+}
+
+// Whether a cell is known to hold a value.
+bool ubf__known_is(const ubf__known_t *known, int64_t cell, int32_t value) {
+  int i = ubf__known_find(known, cell);
+  return i >= 0 && known->values[i] == value;
+}
+
+// Within a block, the value of a cell is known after it's set, and the cell a
+// loop ended on is known to be zero. With that:
+//  - a SET of a cell to the value it already has is removed;
+//  - an ADD to a known cell becomes a SET of the sum, as long as both fit into
+//    any cell width, so neither wrapping nor saturation comes into play;
+//  - a MUL by a cell that's known to be zero is removed, and so is a SCAN
+//    that starts on one;
+//  - a loop that starts on a cell that's known to be zero is removed, and the
+//    block after it joins this one.
+size_t ubf__known_values(ubf_ir_t *ir) {
+  size_t changes = 0;
+  ubf_ir_node_t *node = ubf__ir_first(ir);
+  while (node != NULL) {
+    if (node->kind != UBF_IR_BLOCK) {
+      node = ubf__ir_walk(ir, node);
+      continue;
+    }
+
+    ubf__known_t known;
+    known.count = 0;
+    if (node->prev != NULL) ubf__known_set(&known, 0, 0);
+    // cells are numbered from where the pointer was at the block's start
+    int64_t base = 0;
+    size_t kept = 0, i = 0;
+    while (true) {
+      for (; i < node->length; i++) {
+        ubf_ir_op_t op = node->ops[i];
+        int64_t cell = base + op.offset;
+        int k = ubf__known_find(&known, cell);
+        switch (op.opcode) {
+          case UBF_IR_ADD: {
+            int64_t sum = (k >= 0) ? (int64_t) known.values[k] + op.value : -1;
+            if (k >= 0 && known.values[k] >= 0 && known.values[k] <= 255
+                && sum >= 0 && sum <= 255) {
+              op.opcode = UBF_IR_SET;
+              op.value = (int32_t) sum;
+              known.values[k] = op.value;
+              changes++;
+            } else {
+              ubf__known_forget(&known, cell);
+            }
+            break;
+          }
+          case UBF_IR_SET:
+            if (k >= 0 && known.values[k] == op.value) {
+              changes++;
+              continue;
+            }
+            ubf__known_set(&known, cell, op.value);
+            break;
+          case UBF_IR_MUL:
+            if (ubf__known_is(&known, base, 0)) {
+              changes++;
+              continue;
+            }
+            ubf__known_forget(&known, cell);
+            break;
+          case UBF_IR_GET:
+            ubf__known_forget(&known, cell);
+            break;
+          case UBF_IR_MOVE:
+            base += op.value;
+            break;
+          case UBF_IR_SCAN:
+            if (ubf__known_is(&known, base, 0)) {
+              changes++;
+              continue;
+            }
+            known.count = 0;
+            base = 0;
+            break;
+          default:
+            break;
+        }
+        node->ops[kept++] = op;
+      }
+      node->length = kept;
+      i = kept;
+
+      // a loop that can't be entered takes the block after it along with it,
+      // whose code continues on the same cell
+      ubf_ir_node_t *loop = node->next;
+      if (loop == NULL || !ubf__known_is(&known, base, 0)) break;
+      ubf__ir_remove(loop);
+      changes++;
+      if (loop->next != NULL && loop->next->kind == UBF_IR_BLOCK) {
+        ubf__ir_merge(ir, node);
+      }
+    }
+
+    ubf_ir_node_t *next = ubf__ir_skip(ir, node);
+    if (node->length == 0) ubf__ir_merge(ir, node);
+    node = next;
+  }
+  return changes;
+}
+
+// Moving the pointer only matters for selecting the cells the operations
+// after it work on, so moves are folded into the offsets of those operations,
+// and committed as a single MOVE only where the pointer itself needs to be in
+// place: before a MUL or SCAN, and at the end of the block, where a loop
+// starts or ends. `>+>++<<-` ends up as `ADD +1, 1; ADD +2, 2; ADD +0, -1`,
+// without any moves at all.
+// Offsets are kept within the tape's margin, which the VM always keeps
+// allocated on both sides of the pointer, so if the moves would go further,
+// they're committed early.
+size_t ubf__defer_moves(ubf_ir_t *ir) {
+  #define COMMIT(at) \
+    do { \
+      if (offset != 0) { \
+        ubf_ir_op_t *move = &node->ops[kept++]; \
+        move->opcode = UBF_IR_MOVE; \
+        move->value = (int32_t) offset; \
+        move->offset = 0; \
+        move->source = (at); \
+        offset = 0; \
+        commits++; \
+      } \
+    } while (false)
+
+  size_t changes = 0;
+  for (ubf_ir_node_t *node = ubf__ir_first(ir); node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    if (node->kind != UBF_IR_BLOCK) continue;
+    // every commit replaces at least one of the moves before it, so the
+    // operations are rewritten in place
+    int64_t offset = 0;
+    size_t kept = 0, moves = 0, commits = 0;
+    for (size_t i = 0; i < node->length; i++) {
+      ubf_ir_op_t op = node->ops[i];
+      switch (op.opcode) {
+        case UBF_IR_MOVE:
+          moves++;
+          if (op.value < -UBF_TAPE_MARGIN || op.value > UBF_TAPE_MARGIN) {
+            COMMIT(op.source);
+            node->ops[kept++] = op;
+            commits++;
+            continue;
+          }
+          offset += op.value;
+          if (offset < -UBF_TAPE_MARGIN || offset > UBF_TAPE_MARGIN) {
+            COMMIT(op.source);
+          }
+          continue;
+        case UBF_IR_MUL:
+        case UBF_IR_SCAN:
+          COMMIT(op.source);
+          break;
+        default:
+          if (offset + op.offset < -UBF_TAPE_MARGIN
+              || offset + op.offset > UBF_TAPE_MARGIN) {
+            COMMIT(op.source);
+          }
+          op.offset += (int32_t) offset;
+          break;
+      }
+      node->ops[kept++] = op;
+    }
+    // the move at the end maps to the [ or ] that needs it
+    COMMIT(node->next != NULL ? node->next->start : node->parent->end);
+    node->length = kept;
+    changes += moves - commits;
+  }
+  return changes;
+
+  #undef COMMIT
+}
+
+// Folds an ADD into a SET of the same cell. That's only done while the SET
+// writes a value any cell can hold, since a SET of a value out of range wraps
+// or saturates as a whole, while the cell would have wrapped or saturated
+// before the ADD. Returns whether the ADD was folded.
+bool ubf__fold_into_set(ubf_ir_op_t *set, int32_t value) {
+  int64_t sum = (int64_t) set->value + value;
+  if (set->value < 0 || set->value > 255
+      || sum < INT32_MIN || sum > INT32_MAX) {
+    return false;
+  }
+  set->value = (int32_t) sum;
+  return true;
+}
+
+// An ADD right after a SET of the same cell is folded into it, so `[-]+++`
+// becomes `SET 3`.
+size_t ubf__fold_sets(ubf_ir_t *ir) {
+  size_t changes = 0;
+  for (ubf_ir_node_t *node = ubf__ir_first(ir); node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    if (node->kind != UBF_IR_BLOCK) continue;
+    size_t kept = 0;
+    for (size_t i = 0; i < node->length; i++) {
+      ubf_ir_op_t op = node->ops[i];
+      ubf_ir_op_t *set = (kept > 0) ? &node->ops[kept - 1] : NULL;
+      if (op.opcode == UBF_IR_ADD && set != NULL
+          && set->opcode == UBF_IR_SET && set->offset == op.offset
+          && ubf__fold_into_set(set, op.value)) {
+        changes++;
+        continue;
+      }
+      node->ops[kept++] = op;
+    }
+    node->length = kept;
+  }
+  return changes;
+}
+
+// Whether an operation reads or writes the cell at `offset`, apart from ADDs
+// and SETs of it.
+bool ubf__touches(const ubf_ir_op_t *op, int32_t offset) {
+  switch (op->opcode) {
+    case UBF_IR_MUL:
+      // a MUL reads the cell at the pointer
+      return op->offset == offset || offset == 0;
+    case UBF_IR_PUT:
+    case UBF_IR_GET:
+      return op->offset == offset;
+    default:
+      return false;
+  }
+}
+
+// An ADD or SET of a cell is combined with the last ADD or SET of it in the
+// same block, if nothing in between reads the cell: ADDs into a SET are
+// folded into it, ADDs with the same sign are summed, and a SET makes what was
+// written before it dead. `+>+<+` becomes `ADD +0, 2; ADD +1, 1`. ADDs with
+// different signs are left alone, since they don't add up on saturating
+// cells. Only the last few operations are looked at, so the pass stays linear.
+size_t ubf__merge_cells(ubf_ir_t *ir) {
+  #define WINDOW 16
+
+  size_t changes = 0;
+  for (ubf_ir_node_t *node = ubf__ir_first(ir); node != NULL;
+       node = ubf__ir_walk(ir, node)) {
+    if (node->kind != UBF_IR_BLOCK) continue;
+    size_t kept = 0;
+    for (size_t i = 0; i < node->length; i++) {
+      ubf_ir_op_t op = node->ops[i];
+      bool merged = false;
+      if (op.opcode == UBF_IR_ADD || op.opcode == UBF_IR_SET) {
+        size_t j = kept;
+        size_t stop = (kept > WINDOW) ? kept - WINDOW : 0;
+        while (j > stop) {
+          ubf_ir_op_t *prev = &node->ops[--j];
+          if (prev->opcode == UBF_IR_MOVE || prev->opcode == UBF_IR_SCAN
+              || ubf__touches(prev, op.offset)) {
+            break;
+          }
+          if (prev->offset != op.offset) continue;
+          if (op.opcode == UBF_IR_SET) {
+            // the earlier write is overwritten before anything reads it
+            memmove(prev, prev + 1, (--kept - j) * sizeof(ubf_ir_op_t));
+            changes++;
+            continue;
+          }
+          if (prev->opcode == UBF_IR_SET) {
+            merged = ubf__fold_into_set(prev, op.value);
+          } else if ((prev->value < 0) == (op.value < 0)) {
+            int64_t sum = (int64_t) prev->value + op.value;
+            if (sum >= -INT32_MAX && sum <= INT32_MAX) {
+              prev->value = (int32_t) sum;
+              merged = true;
+            }
+          }
+          break;
+        }
+      }
+      if (merged) {
+        changes++;
+        continue;
+      }
+      node->ops[kept++] = op;
+    }
+    node->length = kept;
+  }
+  return changes;
+
+  #undef WINDOW
+}
+
+typedef size_t (*ubf__pass_proc)(ubf_ir_t *ir);
+
+static const struct {
+  const char *name;
+  int level;
+  ubf__pass_proc run;
+} ubf__passes[UBF_PASS_COUNT] = {
+  [UBF_PASS_CLEAR_LOOPS]  = { "clear-loops",  1, ubf__clear_loops },
+  [UBF_PASS_MUL_LOOPS]    = { "mul-loops",    1, ubf__mul_loops },
+  [UBF_PASS_SCAN_LOOPS]   = { "scan-loops",   1, ubf__scan_loops },
+  [UBF_PASS_DEAD_LOOPS]   = { "dead-loops",   2, ubf__dead_loops },
+  [UBF_PASS_KNOWN_VALUES] = { "known-values", 3, ubf__known_values },
+  [UBF_PASS_DEFER_MOVES]  = { "defer-moves",  1, ubf__defer_moves },
+  [UBF_PASS_FOLD_SETS]    = { "fold-sets",    1, ubf__fold_sets },
+  [UBF_PASS_MERGE_CELLS]  = { "merge-cells",  2, ubf__merge_cells },
+};
+
+const char *ubf_get_pass_name(ubf_pass pass) {
+  return ubf__passes[pass].name;
+}
+
+int ubf_get_pass_level(ubf_pass pass) {
+  return ubf__passes[pass].level;
+}
+
+ubf_pass ubf_find_pass(const char *name) {
+  for (int pass = 0; pass < UBF_PASS_COUNT; pass++) {
+    if (strcmp(ubf__passes[pass].name, name) == 0) return (ubf_pass) pass;
+  }
+  return UBF_PASS_COUNT;
+}
+
+void ubf__run_passes(ubf_ir_t *ir, int opt_level, uint32_t disabled,
+                     FILE *dump, ubf_compile_stats_t *stats) {
+  if (dump != NULL) {
+    fprintf(dump, "; parsed\n");
+    ubf_dump_ir(ir, dump);
+  }
+  for (int pass = 0; pass < UBF_PASS_COUNT; pass++) {
+    if (opt_level < ubf__passes[pass].level || (disabled & (1u << pass))) {
+      continue;
+    }
+    struct timespec start, end;
+    if (stats != NULL) clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t changes = ubf__passes[pass].run(ir);
+    if (stats != NULL) {
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      ubf_pass_stats_t *pass_stats = &stats->passes[pass];
+      pass_stats->runs++;
+      pass_stats->seconds += (end.tv_sec - start.tv_sec)
+                           + (end.tv_nsec - start.tv_nsec) / 1e9;
+      pass_stats->changes += changes;
+    }
+    if (dump != NULL) {
+      fprintf(dump, "; after %s, %zu changes\n", ubf__passes[pass].name,
+              changes);
+      ubf_dump_ir(ir, dump);
+    }
+  }
+}
+
+void ubf_write_compile_stats(const ubf_compile_stats_t *stats, FILE *file) {
+  double total = stats->parse_seconds + stats->lower_seconds;
+  for (int pass = 0; pass < UBF_PASS_COUNT; pass++) {
+    total += stats->passes[pass].seconds;
+  }
+  #define ROW(name, seconds) \
+    fprintf(file, "%-14s %10.3f %5.1f%%", (name), (seconds) * 1e3, \
+            (total > 0) ? 100 * (seconds) / total : 0.0)
+
+  fprintf(file, "%-14s %10s %6s %5s %12s\n", "compiler", "ms", "time",
+          "level", "changes");
+  ROW("parse", stats->parse_seconds);
+  fprintf(file, "\n");
+  for (int pass = 0; pass < UBF_PASS_COUNT; pass++) {
+    const ubf_pass_stats_t *pass_stats = &stats->passes[pass];
+    if (pass_stats->runs == 0) continue;
+    ROW(ubf__passes[pass].name, pass_stats->seconds);
+    fprintf(file, " %5d %12" PRIu64 "\n", ubf__passes[pass].level,
+            pass_stats->changes);
+  }
+  ROW("lower", stats->lower_seconds);
+  fprintf(file, "\n");
+  fprintf(file, "%-14s %10.3f  (%" PRIu64 " programs)\n", "total",
+          total * 1e3, stats->programs);
+
+  #undef ROW
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_passes_h
+#define ubf_passes_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ubf_ir.h"
+
+/// The optimization level the compiler uses by default. This is recorded in
+/// cached bytecode, so a chunk is only reused by a compiler that would have
+/// produced it.
+#define UBF_OPT_LEVEL 2
+
+/// The highest optimization level.
+#define UBF_OPT_LEVEL_MAX 3
+
+/// The optimization passes, in the order they run in.
+typedef enum {
+  // [-] becomes a SET 0 (-O1)
+  UBF_PASS_CLEAR_LOOPS,
+  // loops like [->+>++<<] become a MUL for every cell they add to (-O1)
+  UBF_PASS_MUL_LOOPS,
+  // loops like [>] and [<<] become a SCAN (-O1)
+  UBF_PASS_SCAN_LOOPS,
+  // loops that start on a cell that was just zeroed are removed (-O2)
+  UBF_PASS_DEAD_LOOPS,
+  // the values of cells that were set within a block are tracked, to remove
+  // the operations and loops they make redundant (-O3)
+  UBF_PASS_KNOWN_VALUES,
+  // moves are folded into the offsets of the operations after them (-O1)
+  UBF_PASS_DEFER_MOVES,
+  // an ADD right after a SET of the same cell is folded into it (-O1)
+  UBF_PASS_FOLD_SETS,
+  // ADDs and SETs of a cell are combined with earlier ones in their block,
+  // as long as nothing in between reads it (-O2)
+  UBF_PASS_MERGE_CELLS,
+  UBF_PASS_COUNT
+} ubf_pass;
+
+/// What a pass did, summed over every program it ran on.
+typedef struct {
+  // how many times the pass ran, and for how long
+  uint64_t runs;
+  double seconds;
+  // how many changes it made to the IR, eg. loops replaced or operations
+  // merged
+  uint64_t changes;
+} ubf_pass_stats_t;
+
+/// What the compiler did, summed over every program it compiled.
+typedef struct {
+  uint64_t programs;
+  // the time spent parsing source code into IR, and lowering IR to bytecode
+  double parse_seconds;
+  double lower_seconds;
+  ubf_pass_stats_t passes[UBF_PASS_COUNT];
+} ubf_compile_stats_t;
+
+/// Returns the name of a pass, as it's accepted by ubf_find_pass.
+const char *ubf_get_pass_name(ubf_pass pass);
+
+/// Returns the lowest optimization level a pass runs at.
+int ubf_get_pass_level(ubf_pass pass);
+
+/// Returns the pass with the given name, or UBF_PASS_COUNT if there's none.
+ubf_pass ubf_find_pass(const char *name);
+
+/// Runs every pass included in the optimization level on an IR, except for
+/// the ones in `disabled` (a bit for every pass). If `dump` isn't NULL, the
+/// IR is written to it after every pass that runs. If `stats` isn't NULL, the
+/// passes' runs are added to it.
+void ubf__run_passes(ubf_ir_t *ir, int opt_level, uint32_t disabled,
+                     FILE *dump, ubf_compile_stats_t *stats);
+
+/// Writes the time spent in every part of the compiler, and the changes every
+/// pass made, as a table.
+void ubf_write_compile_stats(const ubf_compile_stats_t *stats, FILE *file);
+
+#endif
@@ -0,0 +1,377 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_profile_c
+#define ubf_profile_c
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ubf_debug.h"
+#include "ubf_io.h"
+#include "ubf_profile.h"
+#include "ubf_program.h"
+#include "ubf_tape.h"
+
+// The amount of loops and instructions listed in a report.
+#define UBF_REPORT_LOOPS 10
+#define UBF_REPORT_INSTRUCTIONS 20
+
+// Turns the offsets in a chunk's source map into lines and columns.
+void ubf__locate(const char *code, size_t length, ubf_profile_t *profile) {
+  // the offsets where each line starts, so every instruction's line can be
+  // found with a binary search
+  size_t nlines = 1;
+  for (size_t i = 0; i < length; i++) {
+    if (code[i] == '\n') nlines++;
+  }
+  size_t *starts = (size_t *)malloc(nlines * sizeof(size_t));
+  starts[0] = 0;
+  for (size_t i = 0, line = 1; i < length; i++) {
+    if (code[i] == '\n') starts[line++] = i + 1;
+  }
+
+  const ubf_chunk_t *chunk = profile->chunk;
+  for (size_t i = 0; i < chunk->length; i++) {
+    size_t offset = chunk->map->offsets[i];
+    size_t low = 0, high = nlines;
+    while (high - low > 1) {
+      size_t mid = low + (high - low) / 2;
+      if (starts[mid] <= offset) low = mid;
+      else high = mid;
+    }
+    profile->locations[i].line = low + 1;
+    profile->locations[i].column = offset - starts[low] + 1;
+  }
+
+  free(starts);
+}
+
+ubf_profile_t *ubf_init_profile(const char *code, size_t length,
+                                const ubf_compile_options_t *options) {
+  ubf_profile_t *profile = (ubf_profile_t *)malloc(sizeof(ubf_profile_t));
+  if (profile == NULL) return NULL;
+  profile->chunk = ubf__alloc_chunk(&ubf_libc_allocator, 0);
+  if (profile->chunk == NULL) {
+    free(profile);
+    return NULL;
+  }
+  if (!ubf__map_chunk(profile->chunk)
+      || ubf__compile_bytecode(code, length, options, profile->chunk)
+           != UBF_COMPILE_OK) {
+    ubf__free_chunk(profile->chunk);
+    free(profile);
+    return NULL;
+  }
+
+  size_t n = profile->chunk->length;
+  profile->locations = (ubf_location_t *)malloc(n * sizeof(ubf_location_t));
+  profile->counts = (uint64_t *)calloc(n, sizeof(uint64_t));
+  profile->taken = (uint64_t *)calloc(n, sizeof(uint64_t));
+  profile->pairs = (uint64_t *)calloc(n, sizeof(uint64_t));
+  profile->triples = (uint64_t *)calloc(n, sizeof(uint64_t));
+  profile->instructions = 0;
+  profile->seconds = 0;
+  ubf__locate(code, length, profile);
+  return profile;
+}
+
+void ubf_free_profile(ubf_profile_t *profile) {
+  ubf__free_chunk(profile->chunk);
+  free(profile->locations);
+  free(profile->counts);
+  free(profile->taken);
+  free(profile->pairs);
+  free(profile->triples);
+  free(profile);
+}
+
+// The profiler's loop is instantiated for every cell width, with wrapping and
+// saturating cells (see ubf_profile_impl.h).
+#define UBF_PROFILE_NAME ubf__profile_8
+#define UBF_PROFILE_CELL uint8_t
+#define UBF_PROFILE_SATURATE 0
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_16
+#define UBF_PROFILE_CELL uint16_t
+#define UBF_PROFILE_SATURATE 0
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_32
+#define UBF_PROFILE_CELL uint32_t
+#define UBF_PROFILE_SATURATE 0
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_64
+#define UBF_PROFILE_CELL uint64_t
+#define UBF_PROFILE_SATURATE 0
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_8_saturating
+#define UBF_PROFILE_CELL uint8_t
+#define UBF_PROFILE_SATURATE 1
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_16_saturating
+#define UBF_PROFILE_CELL uint16_t
+#define UBF_PROFILE_SATURATE 1
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_32_saturating
+#define UBF_PROFILE_CELL uint32_t
+#define UBF_PROFILE_SATURATE 1
+#include "ubf_profile_impl.h"
+
+#define UBF_PROFILE_NAME ubf__profile_64_saturating
+#define UBF_PROFILE_CELL uint64_t
+#define UBF_PROFILE_SATURATE 1
+#include "ubf_profile_impl.h"
+
+typedef ubf_interpret_result (*ubf__profile_fn)(ubf_vm_t *vm,
+                                                ubf_profile_t *profile);
+
+// Runs a profile in the loop instantiated for the VM's cells.
+ubf_interpret_result ubf__profile_run(ubf_vm_t *vm, void *code) {
+  static const ubf__profile_fn loops[2][4] = {
+    { ubf__profile_8, ubf__profile_16,
+      ubf__profile_32, ubf__profile_64 },
+    { ubf__profile_8_saturating, ubf__profile_16_saturating,
+      ubf__profile_32_saturating, ubf__profile_64_saturating }
+  };
+  ubf__set_cell_size(vm, ubf__cell_size(vm->config.cell_width));
+  size_t width;
+  switch (vm->tape.cell_size) {
+    case 2: width = 1; break;
+    case 4: width = 2; break;
+    case 8: width = 3; break;
+    default: width = 0; break;
+  }
+  bool saturate = vm->config.overflow == UBF_OVERFLOW_SATURATE;
+  return loops[saturate][width](vm, (ubf_profile_t *) code);
+}
+
+ubf_interpret_result ubf_profile(ubf_vm_t *vm, ubf_profile_t *profile) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ubf_interpret_result result =
+    ubf__execute_with(vm, ubf__profile_run, profile);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  profile->seconds += (end.tv_sec - start.tv_sec)
+                    + (end.tv_nsec - start.tv_nsec) / 1e9;
+  return result;
+}
+
+// Sorts loops from the hottest one, in the order of the code when they
+// executed equally many instructions.
+int ubf__compare_loops(const void *a, const void *b) {
+  const ubf_loop_profile_t *x = (const ubf_loop_profile_t *)a;
+  const ubf_loop_profile_t *y = (const ubf_loop_profile_t *)b;
+  if (x->instructions != y->instructions) {
+    return (x->instructions < y->instructions) ? 1 : -1;
+  }
+  if (x->start.line != y->start.line) {
+    return (x->start.line > y->start.line) ? 1 : -1;
+  }
+  return (x->start.column > y->start.column)
+       - (x->start.column < y->start.column);
+}
+
+size_t ubf_get_loop_profiles(const ubf_profile_t *profile,
+                             ubf_loop_profile_t **loops) {
+  const ubf_chunk_t *chunk = profile->chunk;
+
+  // sums[i] is the amount of instructions executed before instruction i, so
+  // the amount executed inside a loop is a single subtraction
+  uint64_t *sums = (uint64_t *)malloc((chunk->length + 1) * sizeof(uint64_t));
+  size_t count = 0;
+  sums[0] = 0;
+  for (size_t i = 0; i < chunk->length; i++) {
+    sums[i + 1] = sums[i] + profile->counts[i];
+    if (chunk->code[i].opcode == UBF_JZ) count++;
+  }
+
+  *loops = (ubf_loop_profile_t *)malloc(count * sizeof(ubf_loop_profile_t));
+  size_t n = 0;
+  for (size_t jz = 0; jz < chunk->length; jz++) {
+    if (chunk->code[jz].opcode != UBF_JZ) continue;
+    size_t jnz = jz + 1 + chunk->code[jz].operand;
+    ubf_loop_profile_t *loop = &(*loops)[n++];
+    loop->start = profile->locations[jz];
+    loop->end = profile->locations[jnz];
+    loop->entries = profile->counts[jz];
+    // the body runs whenever the JZ falls through and whenever the JNZ jumps
+    // back
+    loop->iterations = profile->counts[jz] - profile->taken[jz]
+                     + profile->taken[jnz];
+    loop->instructions = sums[jnz + 1] - sums[jz + 1];
+  }
+  free(sums);
+
+  qsort(*loops, count, sizeof(ubf_loop_profile_t), ubf__compare_loops);
+  return count;
+}
+
+typedef struct {
+  uint64_t count;
+  size_t index;
+} ubf__instr_count_t;
+
+// Sorts instructions from the hottest one, in the order of the code when they
+// ran equally often.
+int ubf__compare_instrs(const void *a, const void *b) {
+  const ubf__instr_count_t *x = (const ubf__instr_count_t *)a;
+  const ubf__instr_count_t *y = (const ubf__instr_count_t *)b;
+  if (x->count != y->count) return (x->count < y->count) ? 1 : -1;
+  return (x->index > y->index) - (x->index < y->index);
+}
+
+// Formats an instruction like the disassembler does.
+void ubf__format_instr(const ubf_instr_t *instr, char *buffer, size_t size) {
+  const char *name = ubf_get_opcode_name((ubf_opcode) instr->opcode);
+  switch (instr->opcode) {
+    case UBF_INC: case UBF_DEC:
+    case UBF_PUT: case UBF_GET:
+    case UBF_SET: case UBF_MUL:
+      snprintf(buffer, size, "%-4s%+d, %d", name, instr->offset,
+               instr->operand);
+      break;
+    case UBF_LT: case UBF_RT:
+      snprintf(buffer, size, "%-4s%d", name, instr->operand);
+      break;
+    case UBF_SCAN:
+      snprintf(buffer, size, "%s %+d", name, instr->operand);
+      break;
+    default:
+      snprintf(buffer, size, "%s", name);
+      break;
+  }
+}
+
+void ubf_write_profile_report(const ubf_profile_t *profile, FILE *file) {
+  const ubf_chunk_t *chunk = profile->chunk;
+  double total = profile->instructions ? (double) profile->instructions : 1;
+
+  fprintf(file, "executed %" PRIu64 " instructions in %.3f s\n",
+          profile->instructions, profile->seconds);
+
+  ubf_loop_profile_t *loops;
+  size_t nloops = ubf_get_loop_profiles(profile, &loops);
+  if (nloops > 0) {
+    fprintf(file, "\nhottest loops:\n");
+    fprintf(file, "  %%time  %14s  %12s  %10s  loop\n",
+            "instructions", "iterations", "entries");
+  }
+  for (size_t i = 0; i < nloops && i < UBF_REPORT_LOOPS; i++) {
+    const ubf_loop_profile_t *loop = &loops[i];
+    if (loop->entries == 0) break;
+    fprintf(file, " %6.2f  %14" PRIu64 "  %12" PRIu64 "  %10" PRIu64
+                  "  %zu:%zu-%zu:%zu\n",
+            loop->instructions / total * 100, loop->instructions,
+            loop->iterations, loop->entries,
+            loop->start.line, loop->start.column,
+            loop->end.line, loop->end.column);
+  }
+  free(loops);
+
+  ubf__instr_count_t *order = (ubf__instr_count_t *)
+    malloc(chunk->length * sizeof(ubf__instr_count_t));
+  size_t n = 0;
+  for (size_t i = 0; i < chunk->length; i++) {
+    if (profile->counts[i] == 0) continue;
+    order[n].count = profile->counts[i];
+    order[n].index = i;
+    n++;
+  }
+  qsort(order, n, sizeof(ubf__instr_count_t), ubf__compare_instrs);
+  if (n > 0) {
+    fprintf(file, "\nhottest instructions:\n");
+    fprintf(file, "  %%time  %14s  %-16s  location\n", "count",
+            "instruction");
+  }
+  for (size_t i = 0; i < n && i < UBF_REPORT_INSTRUCTIONS; i++) {
+    size_t index = order[i].index;
+    char instr[32];
+    ubf__format_instr(&chunk->code[index], instr, sizeof(instr));
+    fprintf(file, " %6.2f  %14" PRIu64 "  %-16s  %zu:%zu\n",
+            profile->counts[index] / total * 100, profile->counts[index],
+            instr, profile->locations[index].line,
+            profile->locations[index].column);
+  }
+  free(order);
+}
+
+bool ubf_write_profile(const ubf_profile_t *profile, const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) return false;
+
+  const ubf_chunk_t *chunk = profile->chunk;
+  fprintf(file, "# microbf profile\n");
+  fprintf(file, "total %" PRIu64 " %.6f\n", profile->instructions,
+          profile->seconds);
+
+  // instr <count> <taken> <index> <line> <column> <opcode> <operand> <offset>
+  for (size_t i = 0; i < chunk->length; i++) {
+    const ubf_instr_t *instr = &chunk->code[i];
+    fprintf(file, "instr %" PRIu64 " %" PRIu64 " %zu %zu %zu %s %d %d\n",
+            profile->counts[i], profile->taken[i], i,
+            profile->locations[i].line, profile->locations[i].column,
+            ubf_get_opcode_name((ubf_opcode) instr->opcode),
+            instr->operand, instr->offset);
+  }
+
+  // loop <instructions> <iterations> <entries> <line> <column> <end line>
+  // <end column>
+  ubf_loop_profile_t *loops;
+  size_t nloops = ubf_get_loop_profiles(profile, &loops);
+  for (size_t i = 0; i < nloops; i++) {
+    const ubf_loop_profile_t *loop = &loops[i];
+    fprintf(file, "loop %" PRIu64 " %" PRIu64 " %" PRIu64
+                  " %zu %zu %zu %zu\n",
+            loop->instructions, loop->iterations, loop->entries,
+            loop->start.line, loop->start.column,
+            loop->end.line, loop->end.column);
+  }
+  free(loops);
+
+  // pair <count> <opcode> <opcode> and triple <count> <opcode> <opcode>
+  // <opcode>, summed over every place the sequence appears in the code
+  const size_t n = UBF_FIN + 1;
+  uint64_t *pairs = (uint64_t *)calloc(n * n, sizeof(uint64_t));
+  uint64_t *triples = (uint64_t *)calloc(n * n * n, sizeof(uint64_t));
+  for (size_t i = 0; i + 1 < chunk->length; i++) {
+    size_t a = chunk->code[i].opcode, b = chunk->code[i + 1].opcode;
+    pairs[a * n + b] += profile->pairs[i];
+    if (i + 2 < chunk->length) {
+      size_t c = chunk->code[i + 2].opcode;
+      triples[(a * n + b) * n + c] += profile->triples[i];
+    }
+  }
+  for (size_t i = 0; i < n * n; i++) {
+    if (pairs[i] == 0) continue;
+    fprintf(file, "pair %" PRIu64 " %s %s\n", pairs[i],
+            ubf_get_opcode_name((ubf_opcode) (i / n)),
+            ubf_get_opcode_name((ubf_opcode) (i % n)));
+  }
+  for (size_t i = 0; i < n * n * n; i++) {
+    if (triples[i] == 0) continue;
+    fprintf(file, "triple %" PRIu64 " %s %s %s\n", triples[i],
+            ubf_get_opcode_name((ubf_opcode) (i / (n * n))),
+            ubf_get_opcode_name((ubf_opcode) (i / n % n)),
+            ubf_get_opcode_name((ubf_opcode) (i % n)));
+  }
+  free(pairs);
+  free(triples);
+
+  bool ok = !ferror(file);
+  return (fclose(file) == 0) && ok;
+}
+
+#endif
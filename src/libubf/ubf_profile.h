@@ -0,0 +1,87 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_profile_h
+#define ubf_profile_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ubf_brainfuck.h"
+#include "ubf_compiler.h"
+
+/// A place in the source code. Lines and columns start at 1.
+typedef struct {
+  size_t line;
+  size_t column;
+} ubf_location_t;
+
+/// A loop's counters, gathered from the counters of its jumps.
+typedef struct {
+  // the loop's [ and ]
+  ubf_location_t start, end;
+  // how many times the program arrived at the loop, and how many times the
+  // loop's body was run
+  uint64_t entries;
+  uint64_t iterations;
+  // the amount of instructions executed inside the loop, including the ones
+  // in nested loops
+  uint64_t instructions;
+} ubf_loop_profile_t;
+
+/// An execution profile of a program.
+/// Profiled programs run in an instrumented copy of the interpreter, on
+/// bytecode without superinstructions, so every instruction is counted on its
+/// own. The other engines don't know about profiling, and don't pay for it.
+typedef struct {
+  // the program's bytecode, with a source map
+  ubf_chunk_t *chunk;
+  // the location of every instruction
+  ubf_location_t *locations;
+  // how many times each instruction was executed
+  uint64_t *counts;
+  // how many times each jump was taken
+  uint64_t *taken;
+  // how many times the instruction following each instruction was executed
+  // right after it, and how many times the two following it were
+  uint64_t *pairs;
+  uint64_t *triples;
+  // the total amount of instructions executed, and how long it took
+  uint64_t instructions;
+  double seconds;
+} ubf_profile_t;
+
+/// Compiles `length` bytes of brainfuck code for profiling, with the given
+/// options (NULL for the defaults). Returns NULL if the code doesn't compile.
+ubf_profile_t *ubf_init_profile(const char *code, size_t length,
+                                const ubf_compile_options_t *options);
+
+/// Frees a profile.
+void ubf_free_profile(ubf_profile_t *profile);
+
+/// Runs a program compiled for profiling in a VM, adding to its counters.
+/// The program runs with the VM's cell width, overflow behavior and limits,
+/// and stops like it would in ubf_execute, but always in the profiler: the
+/// VM's engine is ignored.
+ubf_interpret_result ubf_profile(ubf_vm_t *vm, ubf_profile_t *profile);
+
+/// Collects the counters of every loop in a profile, sorted from the one
+/// that executed the most instructions. Returns the amount of loops, the
+/// array must be freed by the caller.
+size_t ubf_get_loop_profiles(const ubf_profile_t *profile,
+                             ubf_loop_profile_t **loops);
+
+/// Writes a human-readable report of the hottest loops and instructions.
+void ubf_write_profile_report(const ubf_profile_t *profile, FILE *file);
+
+/// Writes every counter in a profile to a file, one per line. This is the
+/// format ubf_load_fusion_profile reads.
+/// Returns false if the file couldn't be written.
+bool ubf_write_profile(const ubf_profile_t *profile, const char *path);
+
+#endif
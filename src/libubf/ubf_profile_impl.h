@@ -0,0 +1,129 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+// The profiler's execution loop, instantiated once for every cell width and
+// overflow behavior like the interpreter's (see ubf_interpreter_impl.h), by
+// including this file with these defined:
+//   UBF_PROFILE_NAME      the name of the function
+//   UBF_PROFILE_CELL      the cell's type, an unsigned integer
+//   UBF_PROFILE_SATURATE  1 if cells saturate, 0 if they wrap
+// The parameters are undefined again at the end, and the file is meant to be
+// included more than once, so it doesn't have an include guard.
+
+ubf_interpret_result UBF_PROFILE_NAME(ubf_vm_t *vm, ubf_profile_t *profile) {
+  typedef UBF_PROFILE_CELL cell_t;
+  #define MAX ((cell_t) -1)
+  #define OPERAND (instr->operand)
+  #define CELL (ptr[instr->offset])
+  #define JUMP() \
+    do { \
+      vm->pc += OPERAND; \
+      profile->taken[pc]++; \
+    } while (false)
+  #if UBF_PROFILE_SATURATE
+  # define ADD(amount) CELL = ubf__saturate(CELL, (amount), MAX)
+  #else
+  # define ADD(amount) CELL += (cell_t) (amount)
+  #endif
+
+  const ubf_chunk_t *chunk = profile->chunk;
+  // the instruction executed before the current one, and how many
+  // instructions in a row ended with it
+  size_t last = 0, run = 0;
+  // the tape pointer and the fuel are kept in locals, like in the interpreter
+  cell_t *ptr = (cell_t *) vm->ptr;
+  uint64_t fuel = vm->fuel;
+
+  while (true) {
+    size_t pc = vm->pc++;
+    const ubf_instr_t *instr = &chunk->code[pc];
+    // counted straight in the profile, since a limit jumps out of the loop
+    // and its locals are lost
+    profile->counts[pc]++;
+    profile->instructions++;
+    if (run > 0 && pc == last + 1) {
+      profile->pairs[last]++;
+      if (run > 1) profile->triples[last - 1]++;
+      run++;
+    } else {
+      run = 1;
+    }
+    last = pc;
+
+    switch (instr->opcode) {
+      case UBF_INC: ADD((int64_t) OPERAND); break;
+      case UBF_DEC: ADD(-(int64_t) OPERAND); break;
+      case UBF_LT:
+        ptr = (cell_t *) ubf__tape_move_cells(vm, ptr, -(ptrdiff_t) OPERAND,
+                                              sizeof(cell_t));
+        break;
+      case UBF_RT:
+        ptr = (cell_t *) ubf__tape_move_cells(vm, ptr, OPERAND,
+                                              sizeof(cell_t));
+        break;
+      case UBF_JZ: if (*ptr == 0) JUMP(); break;
+      case UBF_JNZ:
+        if (*ptr != 0) {
+          // charged like in the interpreter, by the length of the loop's body
+          JUMP();
+          if (fuel < (uint64_t) -(int64_t) OPERAND) goto out_of_fuel;
+          fuel -= (uint64_t) -(int64_t) OPERAND;
+        }
+        break;
+      case UBF_PUT:
+        ubf__put_byte(vm, (uint8_t) CELL, OPERAND);
+        if (vm->halt != UBF_OK) goto halt;
+        break;
+      case UBF_GET:
+        CELL = (cell_t) ubf__get_value(vm, CELL, OPERAND);
+        if (vm->halt != UBF_OK) { vm->pc--; goto halt; }
+        break;
+      case UBF_SET:
+        #if UBF_PROFILE_SATURATE
+        CELL = (OPERAND < 0) ? 0
+             : ((uint64_t) OPERAND > MAX) ? MAX
+             : (cell_t) OPERAND;
+        #else
+        CELL = (cell_t) OPERAND;
+        #endif
+        break;
+      case UBF_MUL:
+        #if UBF_PROFILE_SATURATE
+        CELL = ubf__saturate_mul(CELL, OPERAND, *ptr, MAX);
+        #else
+        CELL += (cell_t) ((uint64_t) OPERAND * *ptr);
+        #endif
+        break;
+      case UBF_SCAN:
+        ptr = (cell_t *) ubf__tape_scan_cells(vm, ptr, OPERAND,
+                                              sizeof(cell_t));
+        break;
+      default:
+        vm->ptr = ptr;
+        vm->fuel = fuel;
+        return UBF_OK;
+    }
+  }
+
+out_of_fuel:
+  vm->ptr = ptr;
+  vm->fuel = fuel;
+  return UBF_OUT_OF_FUEL;
+halt:
+  vm->ptr = ptr;
+  vm->fuel = fuel;
+  return vm->halt;
+
+  #undef MAX
+  #undef OPERAND
+  #undef CELL
+  #undef JUMP
+  #undef ADD
+}
+
+#undef UBF_PROFILE_NAME
+#undef UBF_PROFILE_CELL
+#undef UBF_PROFILE_SATURATE
@@ -0,0 +1,135 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_program_c
+#define ubf_program_c
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "ubf_program.h"
+
+ubf_program_t *ubf__alloc_program(const ubf_allocator_t *allocator) {
+  ubf_program_t *program =
+    (ubf_program_t *)ubf__allocate(allocator, sizeof(ubf_program_t));
+  if (program == NULL) return NULL;
+  program->allocator = allocator;
+  program->chunk = NULL;
+  program->cached.mapping = NULL;
+  program->cached.size = 0;
+  program->opt_level = UBF_OPT_LEVEL;
+  atomic_init(&program->references, 1);
+  atomic_init(&program->jit, NULL);
+  atomic_init(&program->direct_threaded, NULL);
+  atomic_init(&program->tail_call, NULL);
+  return program;
+}
+
+ubf_program_t *ubf_compile_program(const char *code, size_t length) {
+  return ubf_compile_program_with_allocator(code, length,
+                                            &ubf_libc_allocator);
+}
+
+ubf_program_t *ubf_compile_program_with_allocator(
+    const char *code, size_t length, const ubf_allocator_t *allocator) {
+  ubf_compile_options_t options;
+  ubf_init_compile_options(&options);
+  options.allocator = allocator;
+  return ubf_compile_program_with_options(code, length, &options);
+}
+
+ubf_program_t *ubf_compile_program_with_options(
+    const char *code, size_t length, const ubf_compile_options_t *options) {
+  ubf_program_t *program = ubf__alloc_program(options->allocator);
+  if (program == NULL) return NULL;
+  program->chunk = ubf__alloc_chunk(options->allocator, 0);
+  program->opt_level = options->opt_level;
+  if (program->chunk == NULL
+      || ubf_compile(code, length, options, program->chunk)
+           != UBF_COMPILE_OK) {
+    ubf_release_program(program);
+    return NULL;
+  }
+  return program;
+}
+
+ubf_program_t *ubf_retain_program(ubf_program_t *program) {
+  atomic_fetch_add_explicit(&program->references, 1, memory_order_relaxed);
+  return program;
+}
+
+void ubf_release_program(ubf_program_t *program) {
+  // the last thread to let go must see everything the others did to the
+  // program, hence acq_rel
+  if (atomic_fetch_sub_explicit(&program->references, 1,
+                                memory_order_acq_rel) != 1) {
+    return;
+  }
+  ubf_jit_code_t *jit = atomic_load_explicit(&program->jit,
+                                             memory_order_relaxed);
+  if (jit != NULL) {
+    ubf__jit_free(jit);
+  }
+  ubf_threaded_code_t *threaded[] = {
+    atomic_load_explicit(&program->direct_threaded, memory_order_relaxed),
+    atomic_load_explicit(&program->tail_call, memory_order_relaxed)
+  };
+  for (size_t i = 0; i < sizeof(threaded) / sizeof(threaded[0]); i++) {
+    if (threaded[i] != NULL) {
+      ubf__threaded_free(threaded[i]);
+    }
+  }
+  if (program->cached.mapping != NULL) {
+    ubf_cache_unload(&program->cached);
+  } else if (program->chunk != NULL) {
+    ubf__free_chunk(program->chunk);
+  }
+  ubf__deallocate(program->allocator, program, sizeof(ubf_program_t));
+}
+
+ubf_jit_code_t *ubf__program_jit(ubf_program_t *program) {
+  ubf_jit_code_t *jit = atomic_load_explicit(&program->jit,
+                                             memory_order_acquire);
+  if (jit != NULL) return jit;
+
+  // VMs racing to run the program for the first time may all compile it, but
+  // only one of them gets to publish its code; the others throw theirs away
+  jit = ubf__jit_compile(program->chunk, program->allocator);
+  if (jit == NULL) return NULL;
+  ubf_jit_code_t *expected = NULL;
+  if (!atomic_compare_exchange_strong_explicit(&program->jit, &expected, jit,
+                                               memory_order_acq_rel,
+                                               memory_order_acquire)) {
+    ubf__jit_free(jit);
+    jit = expected;
+  }
+  return jit;
+}
+
+ubf_threaded_code_t *ubf__program_threaded(ubf_program_t *program,
+                                           ubf_engine engine) {
+  _Atomic(ubf_threaded_code_t *) *slot = (engine == UBF_ENGINE_TAIL_CALL)
+    ? &program->tail_call
+    : &program->direct_threaded;
+  ubf_threaded_code_t *code = atomic_load_explicit(slot, memory_order_acquire);
+  if (code != NULL) return code;
+
+  // same as with the JIT, a VM that loses the race uses the winner's code
+  code = (engine == UBF_ENGINE_TAIL_CALL)
+    ? ubf__tail_call_compile(program->chunk, program->allocator)
+    : ubf__direct_threaded_compile(program->chunk, program->allocator);
+  if (code == NULL) return NULL;
+  ubf_threaded_code_t *expected = NULL;
+  if (!atomic_compare_exchange_strong_explicit(slot, &expected, code,
+                                               memory_order_acq_rel,
+                                               memory_order_acquire)) {
+    ubf__threaded_free(code);
+    code = expected;
+  }
+  return code;
+}
+
+#endif
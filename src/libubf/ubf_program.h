@@ -0,0 +1,63 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_program_h
+#define ubf_program_h
+
+#include <stdatomic.h>
+
+#include "ubf_brainfuck.h"
+#include "ubf_cache.h"
+#include "ubf_compiler.h"
+#include "ubf_jit.h"
+#include "ubf_threaded.h"
+
+/// A compiled program.
+/// Once created, a program's bytecode never changes, so it can be run by any
+/// number of VMs at once without locking. The only mutable state is the
+/// reference count and the code translated lazily for the other engines, all
+/// of which are atomic.
+struct ubf_program_ {
+  // where the program and its bytecode are allocated from
+  const ubf_allocator_t *allocator;
+  // the bytecode, pointing either to a chunk allocated by the compiler or to
+  // the cached chunk below
+  ubf_chunk_t *chunk;
+  // the cache file the bytecode is mapped from, if any
+  ubf_cached_chunk_t cached;
+  // the optimization level the bytecode was compiled at
+  int opt_level;
+  atomic_size_t references;
+  // native code, compiled the first time the program is run with the JIT
+  _Atomic(ubf_jit_code_t *) jit;
+  // code for the threaded engines, translated the first time it's needed
+  _Atomic(ubf_threaded_code_t *) direct_threaded;
+  _Atomic(ubf_threaded_code_t *) tail_call;
+};
+
+/// Runs code in a VM from where it stopped: a program with one of the engines,
+/// or a profile in the profiler.
+typedef ubf_interpret_result (*ubf__run_fn)(ubf_vm_t *vm, void *code);
+
+/// Runs code from the start with `run`, within the VM's limits, the way
+/// ubf_execute runs a program.
+ubf_interpret_result ubf__execute_with(ubf_vm_t *vm, ubf__run_fn run,
+                                       void *code);
+
+/// Allocates a program with a single reference and no bytecode from
+/// `allocator`. Returns NULL if the allocator runs out of memory.
+ubf_program_t *ubf__alloc_program(const ubf_allocator_t *allocator);
+
+/// Returns the program's native code, compiling it if no VM has done that yet.
+/// Returns NULL if the JIT isn't available.
+ubf_jit_code_t *ubf__program_jit(ubf_program_t *program);
+
+/// Returns the program's code for one of the threaded engines, translating it
+/// if no VM has done that yet. Returns NULL if the engine isn't available.
+ubf_threaded_code_t *ubf__program_threaded(ubf_program_t *program,
+                                           ubf_engine engine);
+
+#endif
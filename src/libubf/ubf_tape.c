@@ -0,0 +1,224 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_tape_c
+#define ubf_tape_c
+
+// for memrchr
+#define _GNU_SOURCE
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ubf_tape.h"
+
+#ifdef UBF_TAPE_USE_SSE2
+# include <emmintrin.h>
+#endif
+
+bool ubf__init_tape(ubf_tape_t *tape, const ubf_allocator_t *allocator) {
+  tape->allocator = allocator;
+  tape->cell_size = sizeof(ubf_cell_t);
+  tape->cells = (uint8_t *)
+    ubf__allocate_zeroed(allocator, UBF_TAPE_INITIAL_LENGTH * tape->cell_size);
+  tape->length = (tape->cells != NULL) ? UBF_TAPE_INITIAL_LENGTH : 0;
+  tape->origin = UBF_TAPE_MARGIN;
+  return tape->cells != NULL;
+}
+
+size_t ubf__cell_size(ubf_cell_width width) {
+  switch (width) {
+    case UBF_CELL_16: return 2;
+    case UBF_CELL_32: return 4;
+    case UBF_CELL_64: return 8;
+    default: return 1;
+  }
+}
+
+void ubf__free_tape(ubf_tape_t *tape) {
+  ubf__deallocate(tape->allocator, tape->cells,
+                  tape->length * tape->cell_size);
+  tape->cells = NULL;
+  tape->length = 0;
+}
+
+void ubf__clear_tape(ubf_tape_t *tape) {
+  if (tape->cells != NULL) {
+    memset(tape->cells, 0, tape->length * tape->cell_size);
+  }
+}
+
+void ubf__set_cell_size(ubf_vm_t *vm, size_t size) {
+  ubf_tape_t *tape = &vm->tape;
+  size_t max = vm->config.max_tape;
+  // a tape that couldn't be allocated last time is given another try
+  if (tape->cell_size == size && tape->cells != NULL
+      && (max == 0 || tape->length <= max)) return;
+  size_t length = UBF_TAPE_INITIAL_LENGTH;
+  if (max != 0 && max < length) {
+    length = max;
+  }
+  ubf__deallocate(tape->allocator, tape->cells,
+                  tape->length * tape->cell_size);
+  tape->cell_size = size;
+  tape->cells = (uint8_t *)
+    ubf__allocate_zeroed(tape->allocator, length * size);
+  tape->origin = UBF_TAPE_MARGIN;
+  if (tape->cells == NULL) {
+    tape->length = 0;
+    longjmp(*vm->trap, UBF_OUT_OF_MEMORY);
+  }
+  tape->length = length;
+  vm->ptr = &tape->cells[tape->origin * size];
+}
+
+// The tape is at least doubled, so growth is amortized over many moves.
+void *ubf__grow_tape(ubf_vm_t *vm, void *ptr, size_t left, size_t right) {
+  ubf_tape_t *tape = &vm->tape;
+  size_t size = tape->cell_size;
+  size_t index = (size_t) ((uint8_t *) ptr - tape->cells) / size;
+  size_t needed = tape->length + left + right;
+  size_t length = tape->length * 2;
+  if (length < needed) {
+    length = needed;
+  }
+  // doubling stops at the limit, so the last bit of growth fits under it
+  size_t max = vm->config.max_tape;
+  if (max != 0 && vm->trap != NULL) {
+    if (needed > max) {
+      longjmp(*vm->trap, UBF_TAPE_LIMIT);
+    }
+    if (length > max) {
+      length = max;
+    }
+  }
+  // when growing to the left, all the slack goes there, since that's the
+  // direction the program is moving in
+  size_t extra = length - tape->length;
+  size_t shift = (left != 0) ? extra - right : 0;
+
+  uint8_t *cells = (uint8_t *)ubf__reallocate(tape->allocator, tape->cells,
+                                              tape->length * size,
+                                              length * size);
+  if (cells == NULL) {
+    longjmp(*vm->trap, UBF_OUT_OF_MEMORY);
+  }
+  if (shift != 0) {
+    memmove(&cells[shift * size], cells, tape->length * size);
+    memset(cells, 0, shift * size);
+  }
+  memset(&cells[(shift + tape->length) * size], 0, (extra - shift) * size);
+
+  tape->cells = cells;
+  tape->length = length;
+  tape->origin += shift;
+  return &cells[(index + shift) * size];
+}
+
+// Both scanning functions work on 8-bit cells, and return the distance from
+// `index` to the first zero cell in the scanning direction. All cells outside
+// of the tape are zero, so when there aren't any zeros left in the tape, the
+// distance to the first cell outside of it is returned.
+
+size_t ubf__scan_right(const ubf_cell_t *cells, size_t length,
+                       size_t index, size_t stride) {
+  size_t i = index;
+
+  if (stride == 1) {
+    const ubf_cell_t *zero = memchr(&cells[i], 0, length - i);
+    return (zero != NULL) ? (size_t)(zero - &cells[i]) : length - i;
+  }
+
+  #ifdef UBF_TAPE_USE_SSE2
+  if (16 % stride == 0) {
+    // compare 16 cells at a time, masking out the ones the scan skips over
+    unsigned mask = 0;
+    for (size_t bit = 0; bit < 16; bit += stride) mask |= 1u << bit;
+
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i *) &cells[i]);
+      unsigned hits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)) & mask;
+      if (hits != 0) {
+        return i + __builtin_ctz(hits) - index;
+      }
+    }
+  }
+  #endif
+
+  while (i < length && cells[i] != 0) i += stride;
+  return i - index;
+}
+
+ptrdiff_t ubf__scan_left(const ubf_cell_t *cells, size_t index,
+                         size_t stride) {
+  ptrdiff_t i = index;
+
+  #ifdef __GLIBC__
+  if (stride == 1) {
+    const ubf_cell_t *zero = memrchr(cells, 0, index + 1);
+    return (zero != NULL) ? zero - &cells[i] : -(i + 1);
+  }
+  #endif
+
+  #ifdef UBF_TAPE_USE_SSE2
+  if (16 % stride == 0) {
+    // same as above, the current cell is the last one in each block
+    unsigned mask = 0;
+    for (size_t bit = 0; bit < 16; bit += stride) mask |= 1u << (15 - bit);
+
+    const __m128i zero = _mm_setzero_si128();
+    for (; i >= 15; i -= 16) {
+      __m128i block = _mm_loadu_si128((const __m128i *) &cells[i - 15]);
+      unsigned hits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)) & mask;
+      if (hits != 0) {
+        return i - 15 + (31 - __builtin_clz(hits)) - (ptrdiff_t) index;
+      }
+    }
+  }
+  #endif
+
+  while (i >= 0 && cells[i] != 0) i -= stride;
+  return i - (ptrdiff_t) index;
+}
+
+// Wider cells are scanned one at a time.
+#define UBF__SCAN_WIDE(type)                                              \
+  do {                                                                    \
+    const type *wide = (const type *) tape->cells;                        \
+    ptrdiff_t i = index;                                                  \
+    while (i >= 0 && (size_t) i < tape->length && wide[i] != 0) {         \
+      i += stride;                                                        \
+    }                                                                     \
+    distance = i - (ptrdiff_t) index;                                     \
+  } while (false)
+
+void *ubf__tape_scan_cells(ubf_vm_t *vm, void *ptr, int32_t stride,
+                           size_t size) {
+  ubf_tape_t *tape = &vm->tape;
+  size_t index = (size_t) ((uint8_t *) ptr - tape->cells) / size;
+  ptrdiff_t distance;
+  switch (size) {
+    case 2: UBF__SCAN_WIDE(uint16_t); break;
+    case 4: UBF__SCAN_WIDE(uint32_t); break;
+    case 8: UBF__SCAN_WIDE(uint64_t); break;
+    default:
+      if (stride > 0) {
+        distance = ubf__scan_right(tape->cells, tape->length, index, stride);
+      } else {
+        distance = ubf__scan_left(tape->cells, index,
+                                  (size_t) -(ptrdiff_t) stride);
+      }
+      break;
+  }
+  return ubf__tape_move_cells(vm, ptr, distance, size);
+}
+
+#undef UBF__SCAN_WIDE
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_tape_h
+#define ubf_tape_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ubf_brainfuck.h"
+
+/// Initializes a fresh, zeroed tape of 8-bit cells, allocated from
+/// `allocator`. Returns false if the allocator runs out of memory, leaving the
+/// tape without any cells.
+bool ubf__init_tape(ubf_tape_t *tape, const ubf_allocator_t *allocator);
+
+/// Returns the size of a cell of the given width, in bytes. Unknown widths
+/// get 8-bit cells.
+size_t ubf__cell_size(ubf_cell_width width);
+
+/// Frees a tape's cells.
+void ubf__free_tape(ubf_tape_t *tape);
+
+/// Zeroes all of a tape's cells. The cells stay allocated, so a VM that's
+/// reset doesn't have to grow its tape all over again.
+void ubf__clear_tape(ubf_tape_t *tape);
+
+/// Makes the VM's tape hold cells of `size` bytes, and fit within
+/// config.max_tape. If its cells were of another size, or there are more of
+/// them than the limit allows, the tape starts over, zeroed, with
+/// UBF_TAPE_INITIAL_LENGTH cells or the limit, whichever is fewer, and the
+/// pointer goes back to the origin. If there's no memory for the new cells,
+/// the tape is left without any, and this jumps to the VM's trap.
+void ubf__set_cell_size(ubf_vm_t *vm, size_t size);
+
+/// Grows the VM's tape so that at least `left` more cells exist before its
+/// first cell and `right` more cells exist after its last cell.
+/// Returns the new location of the cell pointed to by `ptr`. If the tape would
+/// outgrow config.max_tape, or there's no memory for it to grow, jumps to the
+/// VM's trap instead.
+void *ubf__grow_tape(ubf_vm_t *vm, void *ptr, size_t left, size_t right);
+
+/// Adds `amount` to a saturating cell whose maximum is `max`.
+static inline uint64_t ubf__saturate(uint64_t value, int64_t amount,
+                                     uint64_t max) {
+  if (amount >= 0) {
+    return ((uint64_t) amount > max - value) ? max : value + amount;
+  }
+  uint64_t down = -(uint64_t) amount;
+  return (down > value) ? 0 : value - down;
+}
+
+/// Adds `factor * count` to a saturating cell, for MUL.
+static inline uint64_t ubf__saturate_mul(uint64_t value, int32_t factor,
+                                         uint64_t count, uint64_t max) {
+  uint64_t magnitude = (factor < 0) ? -(uint64_t) factor : (uint64_t) factor;
+  uint64_t product = (magnitude != 0 && count > max / magnitude)
+                   ? max : magnitude * count;
+  if (product > (uint64_t) INT64_MAX) product = INT64_MAX;
+  return ubf__saturate(value, (factor < 0) ? -(int64_t) product
+                                           : (int64_t) product, max);
+}
+
+/// Moves `ptr` by `amount` cells of `size` bytes, growing the tape first if
+/// the destination or its margin would fall outside of it. `size` must be the
+/// tape's cell size; it's passed in so it's a constant wherever this is
+/// inlined.
+/// Returns the new pointer.
+static inline void *ubf__tape_move_cells(ubf_vm_t *vm, void *ptr,
+                                         ptrdiff_t amount, size_t size) {
+  ubf_tape_t *tape = &vm->tape;
+  size_t index = (size_t) ((uint8_t *) ptr - tape->cells) / size;
+  if (amount < 0) {
+    size_t amt = (size_t) -amount + UBF_TAPE_MARGIN;
+    if (index < amt) {
+      ptr = ubf__grow_tape(vm, ptr, amt, 0);
+    }
+  } else {
+    size_t amt = (size_t) amount + UBF_TAPE_MARGIN;
+    if (tape->length - 1 - index < amt) {
+      ptr = ubf__grow_tape(vm, ptr, 0, amt);
+    }
+  }
+  return (uint8_t *) ptr + amount * (ptrdiff_t) size;
+}
+
+/// Returns whether `ptr` can move by `amount` 8-bit cells without growing the
+/// tape, in which case ubf__tape_move is a plain addition.
+static inline bool ubf__tape_can_move(const ubf_vm_t *vm,
+                                      const ubf_cell_t *ptr,
+                                      ptrdiff_t amount) {
+  size_t index = (size_t) (ptr - vm->tape.cells);
+  if (amount < 0) {
+    return index >= (size_t) -amount + UBF_TAPE_MARGIN;
+  }
+  return vm->tape.length - 1 - index >= (size_t) amount + UBF_TAPE_MARGIN;
+}
+
+/// Moves `ptr` by `amount` 8-bit cells.
+static inline ubf_cell_t *ubf__tape_move(ubf_vm_t *vm, ubf_cell_t *ptr,
+                                         ptrdiff_t amount) {
+  return (ubf_cell_t *)
+    ubf__tape_move_cells(vm, ptr, amount, sizeof(ubf_cell_t));
+}
+
+/// Moves `ptr` by `stride` cells of `size` bytes until it points to a zero
+/// cell, like the loop `[>]` (for a stride of 1) or `[<<]` (for a stride of
+/// -2) would.
+/// Returns the new pointer.
+void *ubf__tape_scan_cells(ubf_vm_t *vm, void *ptr, int32_t stride,
+                           size_t size);
+
+/// Scans over 8-bit cells.
+static inline ubf_cell_t *ubf__tape_scan(ubf_vm_t *vm, ubf_cell_t *ptr,
+                                         int32_t stride) {
+  return (ubf_cell_t *)
+    ubf__tape_scan_cells(vm, ptr, stride, sizeof(ubf_cell_t));
+}
+
+#endif
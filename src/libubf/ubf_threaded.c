@@ -0,0 +1,499 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_threaded_c
+#define ubf_threaded_c
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ubf_fusion.h"
+#include "ubf_io.h"
+#include "ubf_tape.h"
+#include "ubf_threaded.h"
+
+typedef struct ubf__threaded_instr_ ubf__threaded_instr_t;
+
+typedef const ubf__threaded_instr_t *(*ubf__handler_fn)(
+  const ubf__threaded_instr_t *ip, ubf_cell_t *ptr, ubf_vm_t *vm,
+  uint64_t fuel, ubf_cell_t cell);
+
+/// A translated instruction. It's laid out just like ubf_instr_t, with the
+/// opcode replaced by the address of the code that executes it.
+struct ubf__threaded_instr_ {
+  union {
+    // a label in the direct-threaded engine
+    const void *label;
+    // a function in the tail-call engine
+    ubf__handler_fn handler;
+  } to;
+  int32_t operand;
+  int32_t offset;
+};
+
+struct ubf_threaded_code_ {
+  const ubf_allocator_t *allocator;
+  ubf_engine engine;
+  ubf__threaded_instr_t *code;
+  size_t length;
+};
+
+// Copies a chunk's operands and offsets. The handlers are filled in by the
+// engine the code is translated for. Returns NULL if it runs out of memory.
+ubf_threaded_code_t *ubf__threaded_alloc(ubf_chunk_t *chunk,
+                                         ubf_engine engine,
+                                         const ubf_allocator_t *allocator) {
+  ubf_threaded_code_t *threaded = (ubf_threaded_code_t *)
+    ubf__allocate(allocator, sizeof(ubf_threaded_code_t));
+  if (threaded == NULL) return NULL;
+  threaded->code = (ubf__threaded_instr_t *)
+    ubf__allocate(allocator, chunk->length * sizeof(ubf__threaded_instr_t));
+  if (threaded->code == NULL) {
+    ubf__deallocate(allocator, threaded, sizeof(ubf_threaded_code_t));
+    return NULL;
+  }
+  threaded->allocator = allocator;
+  threaded->engine = engine;
+  threaded->length = chunk->length;
+  for (size_t i = 0; i < chunk->length; i++) {
+    threaded->code[i].operand = chunk->code[i].operand;
+    threaded->code[i].offset = chunk->code[i].offset;
+  }
+  return threaded;
+}
+
+void ubf__threaded_free(ubf_threaded_code_t *code) {
+  const ubf_allocator_t *allocator = code->allocator;
+  ubf__deallocate(allocator, code->code,
+                  code->length * sizeof(ubf__threaded_instr_t));
+  ubf__deallocate(allocator, code, sizeof(ubf_threaded_code_t));
+}
+
+/* -------------------------------------------------------------------------- */
+/* Direct threading                                                           */
+/* -------------------------------------------------------------------------- */
+
+#ifdef UBF_VM_USE_COMPUTED_GOTO
+
+// Runs direct-threaded code, starting at vm->pc. Label addresses can't leave
+// the function they're in, so when `code` is NULL, the function hands out its
+// table of labels (indexed by opcode) instead of running anything.
+ubf_interpret_result ubf__direct_threaded_exec(
+  ubf_vm_t *vm, const ubf__threaded_instr_t *code,
+  const void *const **labels) {
+  static const void *const handlers[] = {
+    &&_UBF_INC, &&_UBF_DEC,
+    &&_UBF_LT,  &&_UBF_RT,
+    &&_UBF_JZ,  &&_UBF_JNZ,
+    &&_UBF_PUT, &&_UBF_GET,
+    &&_UBF_SET, &&_UBF_MUL,
+    &&_UBF_SCAN,
+    &&_UBF_FIN,
+    #define UBF_FUSED2(a, b) &&_UBF_##a##_##b,
+    #define UBF_FUSED3(a, b, c) &&_UBF_##a##_##b##_##c,
+    UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+    #undef UBF_FUSED2
+    #undef UBF_FUSED3
+  };
+  if (code == NULL) {
+    *labels = handlers;
+    return UBF_OK;
+  }
+
+  // the instruction pointer, the tape pointer and the fuel are kept in
+  // locals, rather than in the VM, so the compiler can keep them in registers
+  const ubf__threaded_instr_t *ip = &code[vm->pc];
+  const ubf__threaded_instr_t *instr;
+  ubf_cell_t *ptr = vm->ptr;
+  uint64_t fuel = vm->fuel;
+
+  #define DISPATCH() goto *(instr = ip++)->to.label
+  #define OPERAND (instr->operand)
+  #define CELL (ptr[instr->offset])
+  // charges a loop's fuel after jumping back to its start
+  #define CHARGE(operand)                                         \
+    if (fuel < (uint64_t) -(int64_t) (operand)) goto out_of_fuel; \
+    fuel -= (uint64_t) -(int64_t) (operand);
+
+  DISPATCH();
+
+  _UBF_INC:
+    CELL += OPERAND;
+    DISPATCH();
+  _UBF_DEC:
+    CELL -= OPERAND;
+    DISPATCH();
+  _UBF_LT:
+    ptr = ubf__tape_move(vm, ptr, -(ptrdiff_t) OPERAND);
+    DISPATCH();
+  _UBF_RT:
+    ptr = ubf__tape_move(vm, ptr, OPERAND);
+    DISPATCH();
+  _UBF_JZ:
+    if (*ptr == 0) ip += OPERAND;
+    DISPATCH();
+  _UBF_JNZ:
+    if (*ptr != 0) {
+      ip += OPERAND;
+      CHARGE(OPERAND)
+    }
+    DISPATCH();
+  _UBF_PUT:
+    ubf__put(vm, &CELL, OPERAND);
+    if (vm->halt != UBF_OK) {
+      vm->pc = ip - code;
+      goto halt;
+    }
+    DISPATCH();
+  _UBF_GET:
+    ubf__get(vm, &CELL, OPERAND);
+    if (vm->halt != UBF_OK) {
+      vm->pc = instr - code;
+      goto halt;
+    }
+    DISPATCH();
+  _UBF_SET:
+    CELL = OPERAND;
+    DISPATCH();
+  _UBF_MUL:
+    CELL += OPERAND * *ptr;
+    DISPATCH();
+  _UBF_SCAN:
+    ptr = ubf__tape_scan(vm, ptr, OPERAND);
+    DISPATCH();
+  _UBF_FIN:
+    vm->ptr = ptr;
+    vm->fuel = fuel;
+    return UBF_OK;
+  out_of_fuel:
+    vm->pc = ip - code;
+    vm->ptr = ptr;
+    vm->fuel = fuel;
+    return UBF_OUT_OF_FUEL;
+  halt:
+    vm->ptr = ptr;
+    vm->fuel = fuel;
+    return vm->halt;
+
+  #define UBF_PART_PTR ptr
+  #define UBF_PART_INSTR(k) (&instr[k])
+  #define UBF_PART_JUMP(k) ip += (k) + UBF_PART_OPERAND(k); DISPATCH()
+  #define UBF_PART_LOOP(k)                            \
+    ip += (k) + UBF_PART_OPERAND(k);                  \
+    CHARGE(UBF_PART_OPERAND(k))                       \
+    DISPATCH()
+  #define UBF_PART_HALT(n) vm->pc = (instr - code) + (n); goto halt
+  #define UBF_FUSED2(a, b)                            \
+    _UBF_##a##_##b:                                   \
+      UBF_PART_##a(0) UBF_PART_##b(1)                 \
+      ip += 1;                                        \
+      DISPATCH();
+  #define UBF_FUSED3(a, b, c)                         \
+    _UBF_##a##_##b##_##c:                             \
+      UBF_PART_##a(0) UBF_PART_##b(1) UBF_PART_##c(2) \
+      ip += 2;                                        \
+      DISPATCH();
+  UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+  #undef UBF_FUSED2
+  #undef UBF_FUSED3
+  #undef UBF_PART_PTR
+  #undef UBF_PART_INSTR
+  #undef UBF_PART_JUMP
+  #undef UBF_PART_LOOP
+  #undef UBF_PART_HALT
+
+  #undef DISPATCH
+  #undef OPERAND
+  #undef CELL
+  #undef CHARGE
+}
+
+ubf_threaded_code_t *ubf__direct_threaded_compile(
+  ubf_chunk_t *chunk, const ubf_allocator_t *allocator) {
+  const void *const *labels;
+  ubf__direct_threaded_exec(NULL, NULL, &labels);
+
+  ubf_threaded_code_t *threaded =
+    ubf__threaded_alloc(chunk, UBF_ENGINE_DIRECT_THREADED, allocator);
+  if (threaded == NULL) return NULL;
+  for (size_t i = 0; i < chunk->length; i++) {
+    threaded->code[i].to.label = labels[chunk->code[i].opcode];
+  }
+  return threaded;
+}
+
+#else
+
+ubf_threaded_code_t *ubf__direct_threaded_compile(
+  ubf_chunk_t *chunk, const ubf_allocator_t *allocator) {
+  return NULL;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* Tail-call threading                                                        */
+/* -------------------------------------------------------------------------- */
+
+#ifdef UBF_VM_USE_TAIL_CALLS
+
+// Without musttail, GCC only turns the calls into jumps from -O2 up.
+#if !defined(UBF_VM_SUPPORT_MUSTTAIL) && !defined(__clang__)
+# define UBF_TAIL_CALL_ATTRS \
+    __attribute__((optimize("optimize-sibling-calls")))
+#else
+# define UBF_TAIL_CALL_ATTRS
+#endif
+
+// Every handler executes its instruction, then tail-calls the handler of the
+// next one. The instruction pointer, the tape pointer, the VM, the fuel, and
+// the value of the cell under the pointer are passed in argument registers
+// all the way through (five of the six x86-64 has, and of the eight AArch64
+// has), and are never spilled to memory. The cell is loaded as the next
+// handler is called, so a JZ or JNZ tests a register instead of waiting on
+// the load; the handlers that don't touch the tape pass it on as it is.
+// When the program stops, the last handler stores the tape pointer and the
+// fuel in the VM, and returns the instruction the program stopped at.
+#define HANDLER(name)                                                     \
+  static const ubf__threaded_instr_t *UBF_TAIL_CALL_ATTRS name(           \
+    const ubf__threaded_instr_t *ip, ubf_cell_t *ptr, ubf_vm_t *vm,       \
+    uint64_t fuel, ubf_cell_t cell)
+#define NEXT(value) \
+  UBF_VM_MUSTTAIL return ip[1].to.handler(ip + 1, ptr, vm, fuel, (value))
+#define DISPATCH() NEXT(*ptr)
+#define OPERAND (ip->operand)
+#define CELL (ptr[ip->offset])
+#define STOP(at)                                                          \
+  vm->ptr = ptr;                                                          \
+  vm->fuel = fuel;                                                        \
+  return (at)
+// charges a loop's fuel after jumping back to the instruction before its
+// start
+#define CHARGE(operand)                                                   \
+  if (fuel < (uint64_t) -(int64_t) (operand)) {                           \
+    STOP(ip + 1);                                                         \
+  }                                                                       \
+  fuel -= (uint64_t) -(int64_t) (operand);
+
+HANDLER(ubf__tc_inc) {
+  (void) cell;
+  CELL += OPERAND;
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_dec) {
+  (void) cell;
+  CELL -= OPERAND;
+  DISPATCH();
+}
+
+// A call anywhere in a handler makes GCC save the registers that are live
+// across it on entry, even on the paths that don't make the call. So moves
+// only check whether the tape has room, and leave growing it to handlers of
+// their own, which they tail-call.
+#define COLD_HANDLER(name) __attribute__((noinline, cold)) HANDLER(name)
+
+COLD_HANDLER(ubf__tc_lt_grow) {
+  (void) cell;
+  ptr = ubf__tape_move(vm, ptr, -(ptrdiff_t) OPERAND);
+  DISPATCH();
+}
+
+COLD_HANDLER(ubf__tc_rt_grow) {
+  (void) cell;
+  ptr = ubf__tape_move(vm, ptr, OPERAND);
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_lt) {
+  if (!ubf__tape_can_move(vm, ptr, -(ptrdiff_t) OPERAND)) {
+    UBF_VM_MUSTTAIL return ubf__tc_lt_grow(ip, ptr, vm, fuel, cell);
+  }
+  ptr -= OPERAND;
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_rt) {
+  if (!ubf__tape_can_move(vm, ptr, OPERAND)) {
+    UBF_VM_MUSTTAIL return ubf__tc_rt_grow(ip, ptr, vm, fuel, cell);
+  }
+  ptr += OPERAND;
+  DISPATCH();
+}
+
+// jumps don't move the pointer, so the cell is still the same wherever they
+// land
+HANDLER(ubf__tc_jz) {
+  if (cell == 0) ip += OPERAND;
+  NEXT(cell);
+}
+
+HANDLER(ubf__tc_jnz) {
+  if (cell != 0) {
+    int32_t jump = OPERAND;
+    ip += jump;
+    CHARGE(jump)
+  }
+  NEXT(cell);
+}
+
+HANDLER(ubf__tc_put) {
+  ubf__put(vm, &CELL, OPERAND);
+  if (vm->halt != UBF_OK) {
+    STOP(ip + 1);
+  }
+  NEXT(cell);
+}
+
+HANDLER(ubf__tc_get) {
+  (void) cell;
+  ubf__get(vm, &CELL, OPERAND);
+  if (vm->halt != UBF_OK) {
+    STOP(ip);
+  }
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_set) {
+  (void) cell;
+  CELL = OPERAND;
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_mul) {
+  CELL += OPERAND * cell;
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_scan) {
+  (void) cell;
+  ptr = ubf__tape_scan(vm, ptr, OPERAND);
+  DISPATCH();
+}
+
+HANDLER(ubf__tc_fin) {
+  (void) cell;
+  STOP(ip);
+}
+
+// the parts go through memory, and the cell is loaded again at the end. A
+// move that has to grow the tape carries on from its own slot, where it's a
+// plain instruction
+#undef UBF_PART_LT
+#undef UBF_PART_RT
+#define UBF_PART_LT(k)                                                    \
+  if (!ubf__tape_can_move(vm, ptr, -(ptrdiff_t) UBF_PART_OPERAND(k))) {   \
+    UBF_VM_MUSTTAIL return ubf__tc_lt_grow(&ip[k], ptr, vm, fuel, cell);  \
+  }                                                                       \
+  ptr -= UBF_PART_OPERAND(k);
+#define UBF_PART_RT(k)                                                    \
+  if (!ubf__tape_can_move(vm, ptr, UBF_PART_OPERAND(k))) {                \
+    UBF_VM_MUSTTAIL return ubf__tc_rt_grow(&ip[k], ptr, vm, fuel, cell);  \
+  }                                                                       \
+  ptr += UBF_PART_OPERAND(k);
+#define UBF_PART_PTR ptr
+#define UBF_PART_INSTR(k) (&ip[k])
+#define UBF_PART_JUMP(k) ip += (k) + UBF_PART_OPERAND(k); DISPATCH()
+#define UBF_PART_LOOP(k)                            \
+  int32_t jump = UBF_PART_OPERAND(k);               \
+  ip += (k) + jump;                                 \
+  CHARGE(jump)                                      \
+  DISPATCH()
+#define UBF_PART_HALT(n) STOP(ip + (n))
+#define UBF_FUSED2(a, b)                            \
+  HANDLER(ubf__tc_##a##_##b) {                      \
+    (void) cell;                                    \
+    UBF_PART_##a(0) UBF_PART_##b(1)                 \
+    ip += 1;                                        \
+    DISPATCH();                                     \
+  }
+#define UBF_FUSED3(a, b, c)                         \
+  HANDLER(ubf__tc_##a##_##b##_##c) {                \
+    (void) cell;                                    \
+    UBF_PART_##a(0) UBF_PART_##b(1) UBF_PART_##c(2) \
+    ip += 2;                                        \
+    DISPATCH();                                     \
+  }
+UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+#undef UBF_FUSED2
+#undef UBF_FUSED3
+#undef UBF_PART_PTR
+#undef UBF_PART_INSTR
+#undef UBF_PART_JUMP
+#undef UBF_PART_LOOP
+#undef UBF_PART_HALT
+
+#undef HANDLER
+#undef COLD_HANDLER
+#undef NEXT
+#undef DISPATCH
+#undef OPERAND
+#undef CELL
+#undef STOP
+#undef CHARGE
+
+static const ubf__handler_fn ubf__tc_handlers[] = {
+  ubf__tc_inc, ubf__tc_dec,
+  ubf__tc_lt,  ubf__tc_rt,
+  ubf__tc_jz,  ubf__tc_jnz,
+  ubf__tc_put, ubf__tc_get,
+  ubf__tc_set, ubf__tc_mul,
+  ubf__tc_scan,
+  ubf__tc_fin,
+  #define UBF_FUSED2(a, b) ubf__tc_##a##_##b,
+  #define UBF_FUSED3(a, b, c) ubf__tc_##a##_##b##_##c,
+  UBF_SUPERINSTRUCTIONS(UBF_FUSED2, UBF_FUSED3)
+  #undef UBF_FUSED2
+  #undef UBF_FUSED3
+};
+
+ubf_threaded_code_t *ubf__tail_call_compile(ubf_chunk_t *chunk,
+                                            const ubf_allocator_t *allocator) {
+  ubf_threaded_code_t *threaded =
+    ubf__threaded_alloc(chunk, UBF_ENGINE_TAIL_CALL, allocator);
+  if (threaded == NULL) return NULL;
+  for (size_t i = 0; i < chunk->length; i++) {
+    threaded->code[i].to.handler = ubf__tc_handlers[chunk->code[i].opcode];
+  }
+  return threaded;
+}
+
+#else
+
+ubf_threaded_code_t *ubf__tail_call_compile(ubf_chunk_t *chunk,
+                                            const ubf_allocator_t *allocator) {
+  return NULL;
+}
+
+#endif
+
+ubf_interpret_result ubf__threaded_run(ubf_vm_t *vm,
+                                       ubf_threaded_code_t *code) {
+  // both engines start at vm->pc, so they can pick up where ubf_resume left
+  // off
+  #ifdef UBF_VM_USE_TAIL_CALLS
+  if (code->engine == UBF_ENGINE_TAIL_CALL) {
+    const ubf__threaded_instr_t *start = &code->code[vm->pc];
+    const ubf__threaded_instr_t *stop =
+      start->to.handler(start, vm->ptr, vm, vm->fuel,
+                        *(ubf_cell_t *) vm->ptr);
+    vm->pc = stop - code->code;
+    // the program was stopped by I/O, finished, or ran out of fuel at the
+    // start of a loop. I/O is checked first: a PUT that stops the program
+    // returns the instruction after it, which is FIN if it's the last one
+    if (vm->halt != UBF_OK) return vm->halt;
+    if (stop->to.handler == ubf__tc_fin) return UBF_OK;
+    return UBF_OUT_OF_FUEL;
+  }
+  #endif
+  #ifdef UBF_VM_USE_COMPUTED_GOTO
+  return ubf__direct_threaded_exec(vm, code->code, NULL);
+  #endif
+  return UBF_OK;
+}
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef ubf_threaded_h
+#define ubf_threaded_h
+
+#include <stdint.h>
+
+#include "ubf_brainfuck.h"
+#include "ubf_compiler.h"
+
+/// A chunk of bytecode translated for one of the threaded engines.
+typedef struct ubf_threaded_code_ ubf_threaded_code_t;
+
+/// Translates a chunk for the direct-threaded engine, allocating the code
+/// from `allocator`.
+/// Returns NULL if the engine isn't available (it needs computed gotos), or if
+/// the code couldn't be allocated.
+ubf_threaded_code_t *ubf__direct_threaded_compile(
+  ubf_chunk_t *chunk, const ubf_allocator_t *allocator);
+
+/// Translates a chunk for the tail-call-threaded engine, allocating the code
+/// from `allocator`.
+/// Returns NULL if the engine isn't available (see UBF_USE_TAIL_CALLS), or if
+/// the code couldn't be allocated.
+ubf_threaded_code_t *ubf__tail_call_compile(ubf_chunk_t *chunk,
+                                            const ubf_allocator_t *allocator);
+
+/// Runs translated code in a VM, with the engine it was translated for.
+ubf_interpret_result ubf__threaded_run(ubf_vm_t *vm, ubf_threaded_code_t *code);
+
+/// Frees translated code, back to the allocator it came from.
+void ubf__threaded_free(ubf_threaded_code_t *code);
+
+#endif
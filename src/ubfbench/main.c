@@ -0,0 +1,550 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ubf_brainfuck.h>
+#include <ubf_cache.h>
+#include <ubf_compiler.h>
+#include <ubf_program.h>
+
+typedef struct {
+  double min, median, p90, max;
+} stats_t;
+
+typedef struct {
+  char* name;
+  size_t source_bytes;
+  size_t input_bytes;
+  size_t output_bytes;
+  uint64_t output_hash;
+  stats_t compile;
+  // compiling the source to bytecode alone, which is part of compile
+  stats_t bytecode;
+  stats_t execute;
+} result_t;
+
+typedef struct {
+  ubf_engine engine;
+  unsigned warmup;
+  unsigned runs;
+  size_t input_bytes;
+  // run programs through ubf_resume, this much fuel at a time, 0 to run them
+  // through ubf_execute
+  uint64_t slice;
+  ubf_compile_options_t compile;
+} options_t;
+
+double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+// Sorts the samples, and picks the percentiles out of them by nearest rank.
+stats_t summarize(double* samples, unsigned count) {
+  qsort(samples, count, sizeof(double), compare_doubles);
+  stats_t stats;
+  stats.min = samples[0];
+  stats.median = samples[(count - 1) / 2];
+  stats.p90 = samples[(count * 9 + 9) / 10 - 1];
+  stats.max = samples[count - 1];
+  return stats;
+}
+
+bool read_file(const char* path, char** data, size_t* length) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) return false;
+  size_t capacity = 4096;
+  *data = (char*) malloc(capacity);
+  *length = 0;
+  size_t n;
+  while ((n = fread(*data + *length, 1, capacity - *length, file)) > 0) {
+    *length += n;
+    if (*length == capacity) {
+      capacity *= 2;
+      *data = (char*) realloc(*data, capacity);
+    }
+  }
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+// Returns the name of a benchmark: its file name, without the extension.
+char* benchmark_name(const char* path) {
+  const char* base = strrchr(path, '/');
+  base = (base != NULL) ? base + 1 : path;
+  const char* dot = strrchr(base, '.');
+  size_t length = (dot != NULL && dot != base) ? (size_t) (dot - base)
+                                               : strlen(base);
+  char* name = (char*) malloc(length + 1);
+  memcpy(name, base, length);
+  name[length] = '\0';
+  return name;
+}
+
+// Opens the program's input: `program.in` next to the program if there's
+// one, otherwise `bytes` of generated lines of printable text. The input is
+// a regular file either way, so it's read the way ubf reads redirected input.
+int open_input(const char* path, size_t bytes) {
+  const char* dot = strrchr(path, '.');
+  const char* slash = strrchr(path, '/');
+  size_t stem = (dot != NULL && (slash == NULL || dot > slash))
+              ? (size_t) (dot - path) : strlen(path);
+  char* input_path = (char*) malloc(stem + 4);
+  memcpy(input_path, path, stem);
+  strcpy(input_path + stem, ".in");
+  int fd = open(input_path, O_RDONLY);
+  free(input_path);
+  if (fd >= 0) return fd;
+
+  FILE* file = tmpfile();
+  if (file == NULL) return -1;
+  // the text is the same on every run, so timings stay comparable
+  uint32_t state = 2463534242u;
+  for (size_t i = 0; i < bytes; i++) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    fputc((i % 64 == 63) ? '\n' : ' ' + (int) (state % 95), file);
+  }
+  fflush(file);
+  fd = dup(fileno(file));
+  fclose(file);
+  return fd;
+}
+
+// Translates the program for the engine, so the translation is counted as
+// part of compiling rather than of the first run.
+void prepare(ubf_program_t* program, ubf_engine engine) {
+  switch (engine) {
+    case UBF_ENGINE_INTERPRETER:
+      break;
+    case UBF_ENGINE_TAIL_CALL:
+      if (ubf__program_threaded(program, UBF_ENGINE_TAIL_CALL) != NULL) break;
+      // fall through
+    case UBF_ENGINE_DIRECT_THREADED:
+      ubf__program_threaded(program, UBF_ENGINE_DIRECT_THREADED);
+      break;
+    case UBF_ENGINE_JIT:
+      ubf__program_jit(program);
+      break;
+  }
+}
+
+// Runs a program through ubf_resume, `slice` fuel at a time, the way an event
+// loop driving many VMs would: the input is fed to the program through a
+// non-blocking pipe, a chunk whenever it runs out, and its output is flushed
+// whenever it stops. Returns the amount of input fed, or -1 if there's no
+// pipe.
+ptrdiff_t run_sliced(ubf_vm_t* vm, ubf_program_t* program, int input,
+                     uint64_t slice) {
+  int fds[2];
+  if (pipe(fds) != 0) return -1;
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  vm->config.input_fd = fds[0];
+  vm->config.slice = slice;
+
+  // the pipe is empty whenever the program needs input, and a chunk is
+  // smaller than the pipe, so writing it never blocks
+  char chunk[4096];
+  ptrdiff_t fed = 0;
+  ubf_interpret_result result;
+  do {
+    result = ubf_resume(vm, program);
+    if (result == UBF_NEEDS_INPUT) {
+      ssize_t n = (fds[1] >= 0) ? read(input, chunk, sizeof(chunk)) : 0;
+      if (n > 0 && write(fds[1], chunk, (size_t) n) == n) {
+        fed += n;
+      } else if (fds[1] >= 0) {
+        close(fds[1]);
+        fds[1] = -1;
+      }
+    }
+    ubf_flush(vm);
+  } while (result == UBF_NEEDS_INPUT || result == UBF_OUTPUT_READY
+           || result == UBF_YIELD);
+
+  if (fds[1] >= 0) close(fds[1]);
+  // resetting lets go of the pipe before it's closed
+  ubf_reset_vm(vm);
+  close(fds[0]);
+  vm->config.input_fd = input;
+  return fed;
+}
+
+// Runs a benchmark: every run compiles the program anew and executes it on
+// the same input, and the first `warmup` runs aren't counted.
+bool run_benchmark(const char* path, const options_t* options,
+                   result_t* result) {
+  char* code;
+  size_t length;
+  if (!read_file(path, &code, &length)) {
+    perror(path);
+    return false;
+  }
+  int input = open_input(path, options->input_bytes);
+  FILE* output = tmpfile();
+  if (input < 0 || output == NULL) {
+    perror(path);
+    free(code);
+    if (input >= 0) close(input);
+    if (output != NULL) fclose(output);
+    return false;
+  }
+
+  ubf_vm_t* vm = ubf_init_vm();
+  vm->config.engine = options->engine;
+  vm->config.input_fd = input;
+  vm->config.output_fd = fileno(output);
+  vm->config.flush = UBF_FLUSH_ON_EXIT;
+
+  double* compile = (double*) malloc(options->runs * sizeof(double));
+  double* bytecode = (double*) malloc(options->runs * sizeof(double));
+  double* execute = (double*) malloc(options->runs * sizeof(double));
+  bool ok = true;
+  for (unsigned i = 0; i < options->warmup + options->runs; i++) {
+    lseek(input, 0, SEEK_SET);
+    if (ftruncate(fileno(output), 0) != 0
+        || lseek(fileno(output), 0, SEEK_SET) != 0) {
+      perror(path);
+    }
+
+    double t0 = now();
+    ubf_program_t* program =
+      ubf_compile_program_with_options(code, length, &options->compile);
+    double tb = now();
+    if (program == NULL) {
+      fprintf(stderr, "%s: unbalanced loop\n", path);
+      ok = false;
+      break;
+    }
+    prepare(program, options->engine);
+    double t1 = now();
+    if (options->slice != 0) {
+      ptrdiff_t fed = run_sliced(vm, program, input, options->slice);
+      if (fed < 0) {
+        perror(path);
+        ubf_release_program(program);
+        ok = false;
+        break;
+      }
+      // up to a chunk more than the program read
+      result->input_bytes = (size_t) fed;
+    } else {
+      ubf_execute(vm, program);
+      // regular files are mapped as a whole, so the position is the amount
+      // of input the program read
+      result->input_bytes = vm->input.initialized ? vm->input.position : 0;
+      // resetting lets go of the input, so it's read from the start next
+      // time
+      ubf_reset_vm(vm);
+    }
+    double t2 = now();
+    ubf_release_program(program);
+
+    if (i >= options->warmup) {
+      compile[i - options->warmup] = t1 - t0;
+      bytecode[i - options->warmup] = tb - t0;
+      execute[i - options->warmup] = t2 - t1;
+    }
+  }
+
+  if (!ok) {
+    free(compile);
+    free(bytecode);
+    free(execute);
+    ubf_free_vm(vm);
+    fclose(output);
+    close(input);
+    free(code);
+    return false;
+  }
+
+  // the output of the last run is kept, so baselines can tell when a change
+  // made a program print something else
+  rewind(output);
+  char* out = (char*) malloc(4096);
+  size_t capacity = 4096, n;
+  result->output_bytes = 0;
+  while ((n = fread(out + result->output_bytes, 1,
+                    capacity - result->output_bytes, output)) > 0) {
+    result->output_bytes += n;
+    if (result->output_bytes == capacity) {
+      capacity *= 2;
+      out = (char*) realloc(out, capacity);
+    }
+  }
+  result->output_hash = ubf_hash(out, result->output_bytes);
+  free(out);
+
+  result->name = benchmark_name(path);
+  result->source_bytes = length;
+  result->compile = summarize(compile, options->runs);
+  result->bytecode = summarize(bytecode, options->runs);
+  result->execute = summarize(execute, options->runs);
+
+  free(compile);
+  free(bytecode);
+  free(execute);
+  ubf_free_vm(vm);
+  fclose(output);
+  close(input);
+  free(code);
+  return true;
+}
+
+const char* engine_name(ubf_engine engine) {
+  switch (engine) {
+    case UBF_ENGINE_INTERPRETER: return "interpreter";
+    case UBF_ENGINE_DIRECT_THREADED: return "direct";
+    case UBF_ENGINE_TAIL_CALL: return "tail-call";
+    case UBF_ENGINE_JIT: return "jit";
+  }
+  return "?";
+}
+
+void write_stats(FILE* file, const char* key, const stats_t* stats) {
+  fprintf(file, "\"%s\": {\"min\": %.9f, \"median\": %.9f, \"p90\": %.9f, "
+                "\"max\": %.9f}",
+          key, stats->min, stats->median, stats->p90, stats->max);
+}
+
+// Writes the results as JSON. Every benchmark is on a line of its own, which
+// is what read_baseline relies on; times are in seconds.
+bool write_json(const char* path, const options_t* options,
+                const result_t* results, size_t count) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) return false;
+  fprintf(file, "{\n");
+  fprintf(file, "  \"engine\": \"%s\",\n", engine_name(options->engine));
+  fprintf(file, "  \"warmup\": %u,\n", options->warmup);
+  fprintf(file, "  \"runs\": %u,\n", options->runs);
+  fprintf(file, "  \"slice\": %" PRIu64 ",\n", options->slice);
+  fprintf(file, "  \"opt_level\": %d,\n", options->compile.opt_level);
+  fprintf(file, "  \"disabled_passes\": [");
+  bool first = true;
+  for (int pass = 0; pass < UBF_PASS_COUNT; pass++) {
+    if (!(options->compile.disabled_passes & (1u << pass))) continue;
+    fprintf(file, "%s\"%s\"", first ? "" : ", ",
+            ubf_get_pass_name((ubf_pass) pass));
+    first = false;
+  }
+  fprintf(file, "],\n");
+  fprintf(file, "  \"benchmarks\": [\n");
+  for (size_t i = 0; i < count; i++) {
+    const result_t* r = &results[i];
+    fprintf(file, "    {\"name\": \"%s\", \"source_bytes\": %zu, "
+                  "\"input_bytes\": %zu, \"output_bytes\": %zu, "
+                  "\"output_hash\": \"%016" PRIx64 "\", ",
+            r->name, r->source_bytes, r->input_bytes, r->output_bytes,
+            r->output_hash);
+    write_stats(file, "compile", &r->compile);
+    fprintf(file, ", ");
+    write_stats(file, "bytecode", &r->bytecode);
+    fprintf(file, ", ");
+    write_stats(file, "execute", &r->execute);
+    fprintf(file, "}%s\n", (i + 1 < count) ? "," : "");
+  }
+  fprintf(file, "  ]\n");
+  fprintf(file, "}\n");
+  return fclose(file) == 0;
+}
+
+// Looks a benchmark up in a file written by write_json. Returns false if the
+// benchmark isn't in it.
+bool read_baseline(FILE* file, const char* name, result_t* result) {
+  char key[256];
+  snprintf(key, sizeof(key), "{\"name\": \"%s\",", name);
+  char line[1024];
+  rewind(file);
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (strstr(line, key) == NULL) continue;
+    const char* hash = strstr(line, "\"output_hash\": \"");
+    const char* execute = strstr(line, "\"execute\": {");
+    if (hash == NULL || execute == NULL) return false;
+    result->output_hash = strtoull(hash + 16, NULL, 16);
+    return sscanf(execute, "\"execute\": {\"min\": %lf, \"median\": %lf, "
+                           "\"p90\": %lf, \"max\": %lf}",
+                  &result->execute.min, &result->execute.median,
+                  &result->execute.p90, &result->execute.max) == 4;
+  }
+  return false;
+}
+
+// Compares the results to a baseline. Returns the amount of regressions:
+// benchmarks whose median run got slower by more than `threshold` percent,
+// or whose output changed.
+size_t compare_baseline(const char* path, const result_t* results,
+                        size_t count, double threshold) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    return count;
+  }
+  size_t regressions = 0;
+  printf("\ncompared to %s:\n", path);
+  for (size_t i = 0; i < count; i++) {
+    const result_t* r = &results[i];
+    result_t base;
+    if (!read_baseline(file, r->name, &base)) {
+      printf("  %-12s not in the baseline\n", r->name);
+      continue;
+    }
+    double change = (r->execute.median / base.execute.median - 1) * 100;
+    const char* verdict = "";
+    if (base.output_hash != r->output_hash) {
+      verdict = "  output changed";
+      regressions++;
+    } else if (change > threshold) {
+      verdict = "  regression";
+      regressions++;
+    }
+    printf("  %-12s %10.3f ms -> %10.3f ms  %+6.1f%%%s\n", r->name,
+           base.execute.median * 1e3, r->execute.median * 1e3, change,
+           verdict);
+  }
+  fclose(file);
+  return regressions;
+}
+
+void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [--engine=interpreter|direct|tail-call|jit]\n"
+          "       [--warmup=n] [--runs=n] [--input-bytes=n] [--json=file]\n"
+          "       [--baseline=file] [--threshold=percent] [--slice=fuel]\n"
+          "       [-O0|-O1|-O2|-O3] [--no-pass=pass] [--time-passes]\n"
+          "       program...\n"
+          "times compiling and executing each program, and reports the\n"
+          "minimum, median, 90th percentile and maximum of the runs\n"
+          "a program reads program.in if it exists, and generated text of\n"
+          "--input-bytes bytes (4 MiB by default) otherwise\n"
+          "with --baseline, exits with 1 if a median run got slower than in\n"
+          "the baseline by more than --threshold percent (10 by default)\n"
+          "-O and --no-pass pick the compiler's passes, so each can be\n"
+          "measured on its own; --time-passes reports the time each took and\n"
+          "the changes it made, over every run\n"
+          "--slice runs programs through ubf_resume, stopping them every\n"
+          "time they use up that much fuel, and feeds them their input\n"
+          "through a non-blocking pipe\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  options_t options = { UBF_ENGINE_INTERPRETER, 1, 10, 4 << 20, 0, { 0 } };
+  ubf_init_compile_options(&options.compile);
+  ubf_compile_stats_t compile_stats;
+  memset(&compile_stats, 0, sizeof(compile_stats));
+  const char* json_path = NULL;
+  const char* baseline_path = NULL;
+  double threshold = 10;
+  const char** paths = (const char**) malloc(argc * sizeof(char*));
+  size_t count = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--engine=interpreter") == 0) {
+      options.engine = UBF_ENGINE_INTERPRETER;
+    } else if (strcmp(argv[i], "--engine=direct") == 0) {
+      options.engine = UBF_ENGINE_DIRECT_THREADED;
+    } else if (strcmp(argv[i], "--engine=tail-call") == 0) {
+      options.engine = UBF_ENGINE_TAIL_CALL;
+    } else if (strcmp(argv[i], "--engine=jit") == 0) {
+      options.engine = UBF_ENGINE_JIT;
+    } else if (strncmp(argv[i], "--warmup=", 9) == 0) {
+      options.warmup = (unsigned) strtoul(argv[i] + 9, NULL, 10);
+    } else if (strncmp(argv[i], "--runs=", 7) == 0) {
+      options.runs = (unsigned) strtoul(argv[i] + 7, NULL, 10);
+    } else if (strncmp(argv[i], "--input-bytes=", 14) == 0) {
+      options.input_bytes = (size_t) strtoull(argv[i] + 14, NULL, 10);
+    } else if (strncmp(argv[i], "--slice=", 8) == 0) {
+      options.slice = strtoull(argv[i] + 8, NULL, 10);
+    } else if (strncmp(argv[i], "--json=", 7) == 0) {
+      json_path = argv[i] + 7;
+    } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+      baseline_path = argv[i] + 11;
+    } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+      threshold = strtod(argv[i] + 12, NULL);
+    } else if (argv[i][0] == '-' && argv[i][1] == 'O'
+               && argv[i][2] >= '0' && argv[i][2] <= '0' + UBF_OPT_LEVEL_MAX
+               && argv[i][3] == '\0') {
+      options.compile.opt_level = argv[i][2] - '0';
+    } else if (strncmp(argv[i], "--no-pass=", 10) == 0) {
+      ubf_pass pass = ubf_find_pass(argv[i] + 10);
+      if (pass == UBF_PASS_COUNT) {
+        fprintf(stderr, "%s: unknown pass\n", argv[i] + 10);
+        return 1;
+      }
+      options.compile.disabled_passes |= 1u << pass;
+    } else if (strcmp(argv[i], "--time-passes") == 0) {
+      options.compile.stats = &compile_stats;
+    } else if (argv[i][0] != '-') {
+      paths[count++] = argv[i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (count == 0 || options.runs == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  printf("%-12s %10s %10s %10s %10s %10s %10s %10s\n", "benchmark",
+         "compile", "src MB/s", "min", "median", "p90", "max", "I/O MB/s");
+  result_t* results = (result_t*) malloc(count * sizeof(result_t));
+  size_t done = 0;
+  int status = 0;
+  for (size_t i = 0; i < count; i++) {
+    result_t* r = &results[done];
+    if (!run_benchmark(paths[i], &options, r)) {
+      status = 1;
+      continue;
+    }
+    done++;
+    // times are in milliseconds, compiling is reported by its median, and
+    // by how fast the source was compiled to bytecode
+    printf("%-12s %10.3f %10.1f %10.3f %10.3f %10.3f %10.3f %10.1f\n",
+           r->name, r->compile.median * 1e3,
+           r->source_bytes / r->bytecode.median / 1e6, r->execute.min * 1e3,
+           r->execute.median * 1e3, r->execute.p90 * 1e3,
+           r->execute.max * 1e3,
+           (r->input_bytes + r->output_bytes) / r->execute.median / 1e6);
+    fflush(stdout);
+  }
+
+  if (options.compile.stats != NULL) {
+    printf("\n");
+    ubf_write_compile_stats(options.compile.stats, stdout);
+  }
+
+  if (json_path != NULL && !write_json(json_path, &options, results, done)) {
+    perror(json_path);
+    status = 1;
+  }
+  if (baseline_path != NULL
+      && compare_baseline(baseline_path, results, done, threshold) > 0) {
+    status = 1;
+  }
+
+  for (size_t i = 0; i < done; i++) {
+    free(results[i].name);
+  }
+  free(results);
+  free(paths);
+  return status;
+}
@@ -0,0 +1,146 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#include <stdint.h>
+
+#include <ubf_brainfuck.h>
+
+#include "emit_c.h"
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+// The runtime mirrors libubf's tape: an array grown in both directions, with
+// UBF_TAPE_MARGIN cells always kept allocated around the pointer, so the
+// offsets the compiler emits can be used without bounds checks.
+static const char *includes =
+  "#include <stddef.h>\n"
+  "#include <stdint.h>\n"
+  "#include <stdio.h>\n"
+  "#include <stdlib.h>\n"
+  "#include <string.h>\n"
+  "\n";
+
+// The cell type is declared in between. The helpers are inline so a program
+// that doesn't use some of them compiles without unused function warnings.
+static const char *prelude =
+  "#define MARGIN " STRINGIFY(UBF_TAPE_MARGIN) "\n"
+  "#define INITIAL_LENGTH " STRINGIFY(UBF_TAPE_INITIAL_LENGTH) "\n"
+  "\n"
+  "static cell *tape;\n"
+  "static size_t length;\n"
+  "\n"
+  "static inline cell *grow(cell *p, size_t left, size_t right) {\n"
+  "  size_t index = p - tape;\n"
+  "  size_t new_length = length * 2;\n"
+  "  if (new_length < length + left + right) {\n"
+  "    new_length = length + left + right;\n"
+  "  }\n"
+  "  size_t extra = new_length - length;\n"
+  "  size_t shift = (left != 0) ? extra - right : 0;\n"
+  "  tape = (cell *)realloc(tape, new_length * sizeof(cell));\n"
+  "  if (tape == NULL) {\n"
+  "    fputs(\"out of memory\\n\", stderr);\n"
+  "    exit(1);\n"
+  "  }\n"
+  "  if (shift != 0) {\n"
+  "    memmove(&tape[shift], tape, length * sizeof(cell));\n"
+  "    memset(tape, 0, shift * sizeof(cell));\n"
+  "  }\n"
+  "  memset(&tape[shift + length], 0, (extra - shift) * sizeof(cell));\n"
+  "  length = new_length;\n"
+  "  return &tape[index + shift];\n"
+  "}\n"
+  "\n"
+  "static inline cell *move(cell *p, ptrdiff_t amount) {\n"
+  "  size_t index = p - tape;\n"
+  "  if (amount < 0 && index < (size_t) -amount + MARGIN) {\n"
+  "    p = grow(p, (size_t) -amount + MARGIN, 0);\n"
+  "  } else if (amount > 0 && length - 1 - index < (size_t) amount + MARGIN) {\n"
+  "    p = grow(p, 0, (size_t) amount + MARGIN);\n"
+  "  }\n"
+  "  return p + amount;\n"
+  "}\n"
+  "\n"
+  "static inline cell *scan(cell *p, ptrdiff_t stride) {\n"
+  "  ptrdiff_t i = p - tape;\n"
+  "  if (sizeof(cell) == 1 && stride == 1) {\n"
+  "    cell *zero = (cell *)memchr(p, 0, length - i);\n"
+  "    return move(p, (zero != NULL) ? zero - p : (ptrdiff_t) length - i);\n"
+  "  }\n"
+  "  while (i >= 0 && (size_t) i < length && tape[i] != 0) i += stride;\n"
+  "  return move(p, i - (p - tape));\n"
+  "}\n"
+  "\n"
+  "static inline void put(cell value, int32_t amt) {\n"
+  "  for (int32_t i = 0; i < amt; i++) putchar((char) value);\n"
+  "}\n"
+  "\n"
+  "static inline cell get(cell value, int32_t amt) {\n"
+  "  for (int32_t i = 0; i < amt; i++) {\n"
+  "    int c = getchar();\n"
+  "    value = (c == EOF) ? (cell) -1 : (cell) c;\n"
+  "  }\n"
+  "  return value;\n"
+  "}\n"
+  "\n"
+  "int main(void) {\n"
+  "  length = INITIAL_LENGTH;\n"
+  "  tape = (cell *)calloc(length, sizeof(cell));\n"
+  "  cell *p = &tape[MARGIN];\n"
+  "\n";
+
+static const char *epilogue =
+  "\n"
+  "  free(tape);\n"
+  "  return 0;\n"
+  "}\n";
+
+void emit_c(ubf_chunk_t *chunk, const char *name, unsigned cell_bits,
+            FILE *out) {
+  #define INDENT() fprintf(out, "%*s", (int) depth * 2 + 2, "")
+
+  fprintf(out, "/* generated by ubfc from %s */\n\n", name);
+  fputs(includes, out);
+  fprintf(out, "typedef uint%u_t cell;\n\n", cell_bits);
+  fputs(prelude, out);
+
+  size_t depth = 0;
+  for (size_t i = 0; i < chunk->length; i++) {
+    ubf_instr_t *instr = &chunk->code[i];
+    int32_t off = instr->offset;
+    int32_t op = instr->operand;
+
+    // the C compiler does its own fusing, so superinstructions are treated as
+    // their first part, and the rest of the parts are emitted on their own
+    ubf_opcode opcode = ubf__base_opcode(instr->opcode);
+
+    if (opcode == UBF_JNZ) depth--;
+    if (opcode != UBF_FIN) INDENT();
+
+    switch (opcode) {
+      case UBF_INC: fprintf(out, "p[%d] += %d;\n", off, op); break;
+      case UBF_DEC: fprintf(out, "p[%d] -= %d;\n", off, op); break;
+      case UBF_SET: fprintf(out, "p[%d] = %d;\n", off, op); break;
+      case UBF_MUL: fprintf(out, "p[%d] += %d * p[0];\n", off, op); break;
+      case UBF_LT: fprintf(out, "p = move(p, -%d);\n", op); break;
+      case UBF_RT: fprintf(out, "p = move(p, %d);\n", op); break;
+      case UBF_SCAN: fprintf(out, "p = scan(p, %d);\n", op); break;
+      case UBF_PUT: fprintf(out, "put(p[%d], %d);\n", off, op); break;
+      case UBF_GET: fprintf(out, "p[%d] = get(p[%d], %d);\n", off, off, op);
+                    break;
+      // jumps always come in pairs, one at either end of a loop
+      case UBF_JZ: fprintf(out, "while (p[0] != 0) {\n"); depth++; break;
+      case UBF_JNZ: fprintf(out, "}\n"); break;
+      case UBF_FIN: break;
+      default: break;
+    }
+  }
+
+  fputs(epilogue, out);
+
+  #undef INDENT
+}
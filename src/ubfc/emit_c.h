@@ -0,0 +1,20 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#ifndef emit_c_h
+#define emit_c_h
+
+#include <stdio.h>
+
+#include <ubf_compiler.h>
+
+/// Writes a standalone C program executing a chunk of bytecode to a file.
+/// `name` is the name of the source file, used in the header comment. Cells
+/// are `cell_bits` wide (8, 16, 32 or 64), and wrap around.
+void emit_c(ubf_chunk_t *chunk, const char *name, unsigned cell_bits,
+            FILE *out);
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * microbf brainfuck interpreter
+ * copyright (C) iLiquid, 2019
+ * licensed under the MIT license
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ubf_compiler.h>
+
+#include "emit_c.h"
+
+typedef struct {
+  char* string;
+  size_t length;
+} string_t;
+
+bool read_file(FILE* file, string_t* result) {
+  size_t capacity = 4096;
+  result->string = (char*) malloc(capacity);
+  result->length = 0;
+
+  size_t readlen;
+  while ((readlen = fread(&result->string[result->length], 1,
+                          capacity - result->length, file)) > 0) {
+    result->length += readlen;
+    if (result->length == capacity) {
+      capacity *= 2;
+      result->string = (char*) realloc(result->string, capacity);
+    }
+  }
+  return !ferror(file);
+}
+
+void usage(const char* name) {
+  fprintf(stderr, "usage: %s [--cell-width=8|16|32|64] [-O0|-O1|-O2|-O3] "
+                  "[-o output.c] [input.b]\n", name);
+  fprintf(stderr, "compiles brainfuck to a standalone C program\n");
+}
+
+int main(int argc, char** argv) {
+  const char* input = NULL;
+  const char* output = NULL;
+  unsigned cell_bits = 8;
+  ubf_compile_options_t options;
+  ubf_init_compile_options(&options);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strncmp(argv[i], "--cell-width=", 13) == 0) {
+      cell_bits = (unsigned) strtoul(argv[i] + 13, NULL, 10);
+      if (cell_bits != 8 && cell_bits != 16 && cell_bits != 32
+          && cell_bits != 64) {
+        usage(argv[0]);
+        return 1;
+      }
+    } else if (argv[i][0] == '-' && argv[i][1] == 'O'
+               && argv[i][2] >= '0' && argv[i][2] <= '0' + UBF_OPT_LEVEL_MAX
+               && argv[i][3] == '\0') {
+      options.opt_level = argv[i][2] - '0';
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage(argv[0]);
+      return 1;
+    } else if (input == NULL) {
+      input = argv[i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  FILE* in = stdin;
+  if (input != NULL && strcmp(input, "-") != 0) {
+    in = fopen(input, "rb");
+    if (in == NULL) {
+      perror(input);
+      return 1;
+    }
+  }
+  string_t code;
+  bool ok = read_file(in, &code);
+  if (in != stdin) fclose(in);
+  if (!ok) {
+    perror(input != NULL ? input : "stdin");
+    return 1;
+  }
+
+  ubf_chunk_t* chunk = ubf__alloc_chunk(&ubf_libc_allocator, 0);
+  if (ubf_compile(code.string, code.length, &options, chunk)
+      != UBF_COMPILE_OK) {
+    fprintf(stderr, "%s: unbalanced loop\n", input != NULL ? input : "stdin");
+    ubf__free_chunk(chunk);
+    free(code.string);
+    return 1;
+  }
+
+  FILE* out = stdout;
+  if (output != NULL) {
+    out = fopen(output, "w");
+    if (out == NULL) {
+      perror(output);
+      ubf__free_chunk(chunk);
+      free(code.string);
+      return 1;
+    }
+  }
+  emit_c(chunk, input != NULL ? input : "stdin", cell_bits, out);
+  // write errors only show up once the output's flushed
+  int status = 0;
+  if ((out != stdout) ? fclose(out) != 0 : fflush(out) != 0) {
+    perror(output != NULL ? output : "stdout");
+    status = 1;
+  }
+
+  ubf__free_chunk(chunk);
+  free(code.string);
+
+  return status;
+}
@@ -4,78 +4,488 @@
  * licensed under the MIT license
  */
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <ubf_batch.h>
 #include <ubf_brainfuck.h>
-
-// #define BENCHMARK
-
-#ifdef BENCHMARK
-# include "cycle.h"
-#endif
+#include <ubf_cache.h>
+#include <ubf_fusion.h>
+#include <ubf_profile.h>
 
 typedef struct {
   char* string;
   size_t length;
+  // whether the string is a read-only mapping of a file
+  bool mapped;
 } string_t;
 
-void read_stdin(string_t* result) {
-  #define BUF_SIZE 4
-  #define NEW_STR(cap) (char*) malloc(cap * sizeof(char))
-
+bool read_stdin(string_t* result) {
+  size_t capacity = 4096;
+  result->string = (char*) malloc(capacity);
   result->length = 0;
-  result->string = NULL;
+  result->mapped = false;
 
-  int readlen;
-  char readbuf[BUF_SIZE];
-  while ((readlen = read(STDIN_FILENO, readbuf, BUF_SIZE)) > 0) {
-    if (result->string == NULL) {
-      result->string = NEW_STR(result->length + readlen + 1);
-      memcpy(&result->string[result->length], readbuf, readlen);
-    } else {
-      char* old_string = result->string;
-      result->string = NEW_STR(result->length + readlen + 1);
-      memcpy(result->string, old_string, result->length);
-      free(old_string);
-      memcpy(&result->string[result->length], readbuf, readlen);
+  ssize_t readlen;
+  while ((readlen = read(STDIN_FILENO, &result->string[result->length],
+                         capacity - result->length)) != 0) {
+    if (readlen < 0) {
+      if (errno == EINTR) continue;
+      free(result->string);
+      result->string = NULL;
+      return false;
     }
     result->length += readlen;
+    // the buffer grows geometrically, so reading is linear in the source's
+    // length
+    if (result->length == capacity) {
+      capacity *= 2;
+      result->string = (char*) realloc(result->string, capacity);
+    }
   }
+  return true;
+}
 
-  // C strings are always null-terminated, if we don't add a null byte we get
-  // an invalid read (and possibly a segmentation fault).
-  result->string[result->length] = '\0';
+bool map_file(const char* path, string_t* result) {
+  result->string = NULL;
+  result->length = 0;
+  result->mapped = false;
 
-  #undef NEW_STR
-  #undef BUF_SIZE
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  if (st.st_size > 0) {
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    result->string = (char*) data;
+    result->length = st.st_size;
+    result->mapped = true;
+  }
+  close(fd);
+  return true;
 }
 
 void free_string(string_t* string) {
-  free(string->string);
+  if (string->mapped) {
+    munmap(string->string, string->length);
+  } else {
+    free(string->string);
+  }
 }
 
-int main(void) {
-  string_t code;
-  read_stdin(&code);
+// Creates a directory along with its parents.
+bool make_dirs(const char* path) {
+  char* dir = strdup(path);
+  for (char* p = dir + 1; ; p++) {
+    if (*p != '/' && *p != '\0') continue;
+    char c = *p;
+    *p = '\0';
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+      free(dir);
+      return false;
+    }
+    if (c == '\0') break;
+    *p = c;
+  }
+  free(dir);
+  return true;
+}
 
-  #ifdef BENCHMARK
-  ticks t0 = getticks();
-  #endif
+// Returns the default cache directory, or NULL if there's none.
+char* default_cache_dir(void) {
+  const char* base = getenv("XDG_CACHE_HOME");
+  const char* suffix = "/microbf";
+  if (base == NULL || base[0] == '\0') {
+    base = getenv("HOME");
+    suffix = "/.cache/microbf";
+  }
+  if (base == NULL || base[0] == '\0') return NULL;
+  char* dir = (char*) malloc(strlen(base) + strlen(suffix) + 1);
+  strcpy(dir, base);
+  strcat(dir, suffix);
+  return dir;
+}
 
-  ubf_vm_t* vm = ubf_init_vm();
-  ubf_interpret(vm, code.string);
+// Returns the program, reusing the bytecode cached in `cache_dir` if it was
+// compiled from the same source at the same level before, and caching it
+// otherwise. Files are named after a hash of the source and the level, which
+// only have to find the file; the source itself is kept in the file, and
+// compared when it's loaded. With the level in the name, compiling the same
+// program at another level adds a file instead of replacing the cached one.
+ubf_program_t* load_cached(const char* cache_dir, string_t* code,
+                           const ubf_compile_options_t* options) {
+  uint64_t hash = ubf_hash(code->string, code->length);
+  char* path = (char*) malloc(strlen(cache_dir) + 48);
+  sprintf(path, "%s/%016" PRIx64 "-O%d.ubc", cache_dir, hash,
+          options->opt_level);
+
+  ubf_cache_result result;
+  ubf_program_t* program =
+    ubf_cache_load_program(path, code->string, code->length,
+                           options->opt_level, &result);
+  if (program == NULL) {
+    program = ubf_compile_program_with_options(code->string, code->length,
+                                               options);
+    // the cache is only an optimization, failing to write it isn't an error
+    if (program != NULL && make_dirs(cache_dir)) {
+      ubf_cache_write_program(path, program, code->string, code->length);
+    }
+  }
+
+  free(path);
+  return program;
+}
+
+typedef struct {
+  char** paths;
+  size_t count;
+  size_t capacity;
+} path_list_t;
+
+void add_path(path_list_t* list, char* path) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 64;
+    list->paths = (char**) realloc(list->paths,
+                                   list->capacity * sizeof(char*));
+  }
+  list->paths[list->count++] = path;
+}
 
-  #ifdef BENCHMARK
-  ticks t1 = getticks();
-  double time = elapsed(t1, t0);
-  printf("\nfinished in %f ticks\n", time);
-  #endif
+int is_visible(const struct dirent* entry) {
+  return entry->d_name[0] != '.';
+}
+
+// Adds a batch input. Directories are expanded to the regular files in them,
+// in alphabetical order.
+bool add_input(path_list_t* list, const char* path) {
+  struct stat st;
+  if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+    add_path(list, strdup(path));
+    return true;
+  }
 
+  struct dirent** entries;
+  int n = scandir(path, &entries, is_visible, alphasort);
+  if (n < 0) return false;
+  for (int i = 0; i < n; i++) {
+    char* file = (char*) malloc(strlen(path) + strlen(entries[i]->d_name) + 2);
+    sprintf(file, "%s/%s", path, entries[i]->d_name);
+    if (stat(file, &st) == 0 && S_ISREG(st.st_mode)) {
+      add_path(list, file);
+    } else {
+      free(file);
+    }
+    free(entries[i]);
+  }
+  free(entries);
+  return true;
+}
+
+// Describes why a program was stopped.
+const char* describe_result(ubf_interpret_result result) {
+  switch (result) {
+    case UBF_OUT_OF_FUEL: return "out of fuel";
+    case UBF_TAPE_LIMIT: return "tape limit exceeded";
+    case UBF_OUTPUT_LIMIT: return "output limit exceeded";
+    case UBF_COMPILE_ERROR: return "unbalanced loop";
+    case UBF_OUT_OF_MEMORY: return "out of memory";
+    default: return "ok";
+  }
+}
+
+// Runs the program in the profiler, then reports on the profile and writes it
+// out. Profiled programs aren't cached, they're compiled with a source map.
+// A program stopped by a limit is still reported on, up to where it stopped.
+int run_profiled(const char* name, const string_t* code,
+                 const ubf_compile_options_t* options,
+                 const ubf_vm_config_t* config, const char* path) {
+  ubf_profile_t* profile =
+    ubf_init_profile(code->string, code->length, options);
+  if (profile == NULL) {
+    fprintf(stderr, "%s: %s\n", name, describe_result(UBF_COMPILE_ERROR));
+    return 1;
+  }
+  ubf_vm_t* vm = ubf_init_vm();
+  vm->config = *config;
+  ubf_interpret_result result = ubf_profile(vm, profile);
   ubf_free_vm(vm);
 
+  int status = 0;
+  if (result != UBF_OK) {
+    fprintf(stderr, "%s: %s\n", name, describe_result(result));
+    status = 1;
+  }
+  ubf_write_profile_report(profile, stderr);
+  if (!ubf_write_profile(profile, path)) {
+    perror(path);
+    status = 1;
+  }
+  ubf_free_profile(profile);
+  return status;
+}
+
+void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [--jit] [--engine=interpreter|direct|tail-call|jit]\n"
+          "       [--eof=-1|0|unchanged] [--cell-width=8|16|32|64]\n"
+          "       [--saturate] [--fuel=n] [--max-tape=cells]\n"
+          "       [--max-output=bytes] [--cache-dir=dir] [--no-cache]\n"
+          "       [--fusion-profile=profile] [--profile[=profile]]\n"
+          "       [-O0|-O1|-O2|-O3] [--no-pass=pass] [--dump-ir]\n"
+          "       [--time-passes] [file]\n"
+          "       %s --batch [--threads=n] [--output-dir=dir] [--headers]\n"
+          "       [options] file input...\n"
+          "runs the brainfuck program in file, or read from stdin if no file\n"
+          "is given\n"
+          "with --batch, runs the program once for every input file (or every\n"
+          "file in an input directory), in parallel\n"
+          "with --cell-width, cells are wider than a byte; with --saturate,\n"
+          "they stop at 0 and their maximum instead of wrapping around\n"
+          "with --fuel, --max-tape or --max-output, the program is stopped\n"
+          "once it runs that long (about n instructions), or uses that much\n"
+          "memory or output\n"
+          "with --profile, reports where the program spends its time on\n"
+          "stderr, and writes the full profile to a file (ubf.profile by\n"
+          "default); the program runs in the interpreter, within the limits\n"
+          "with -O, the compiler optimizes less or more (-O2 by default);\n"
+          "--no-pass skips one of its passes, --dump-ir writes the program's\n"
+          "IR to stderr after every pass, and --time-passes reports how long\n"
+          "each pass took\n",
+          name, name);
+}
+
+int main(int argc, char **argv) {
+  ubf_engine engine = UBF_ENGINE_INTERPRETER;
+  ubf_eof_behavior eof = UBF_EOF_MINUS_ONE;
+  ubf_cell_width cell_width = UBF_CELL_8;
+  ubf_overflow_behavior overflow = UBF_OVERFLOW_WRAP;
+  uint64_t fuel = 0;
+  size_t max_tape = 0;
+  size_t max_output = 0;
+  const char* path = NULL;
+  char* cache_dir = default_cache_dir();
+  bool batch_mode = false;
+  ubf_batch_t batch;
+  ubf_init_batch(&batch);
+  path_list_t inputs = { NULL, 0, 0 };
+  const char* fusion_profile = NULL;
+  const char* profile_path = NULL;
+  ubf_compile_options_t options;
+  ubf_init_compile_options(&options);
+  ubf_compile_stats_t compile_stats;
+  memset(&compile_stats, 0, sizeof(compile_stats));
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--jit") == 0
+        || strcmp(argv[i], "--engine=jit") == 0) {
+      engine = UBF_ENGINE_JIT;
+    } else if (strcmp(argv[i], "--engine=interpreter") == 0) {
+      engine = UBF_ENGINE_INTERPRETER;
+    } else if (strcmp(argv[i], "--engine=direct") == 0) {
+      engine = UBF_ENGINE_DIRECT_THREADED;
+    } else if (strcmp(argv[i], "--engine=tail-call") == 0) {
+      engine = UBF_ENGINE_TAIL_CALL;
+    } else if (strcmp(argv[i], "--eof=-1") == 0) {
+      eof = UBF_EOF_MINUS_ONE;
+    } else if (strcmp(argv[i], "--eof=0") == 0) {
+      eof = UBF_EOF_ZERO;
+    } else if (strcmp(argv[i], "--eof=unchanged") == 0) {
+      eof = UBF_EOF_UNCHANGED;
+    } else if (strcmp(argv[i], "--cell-width=8") == 0) {
+      cell_width = UBF_CELL_8;
+    } else if (strcmp(argv[i], "--cell-width=16") == 0) {
+      cell_width = UBF_CELL_16;
+    } else if (strcmp(argv[i], "--cell-width=32") == 0) {
+      cell_width = UBF_CELL_32;
+    } else if (strcmp(argv[i], "--cell-width=64") == 0) {
+      cell_width = UBF_CELL_64;
+    } else if (strcmp(argv[i], "--saturate") == 0) {
+      overflow = UBF_OVERFLOW_SATURATE;
+    } else if (strncmp(argv[i], "--fuel=", 7) == 0) {
+      fuel = strtoull(argv[i] + 7, NULL, 10);
+    } else if (strncmp(argv[i], "--max-tape=", 11) == 0) {
+      max_tape = (size_t) strtoull(argv[i] + 11, NULL, 10);
+    } else if (strncmp(argv[i], "--max-output=", 13) == 0) {
+      max_output = (size_t) strtoull(argv[i] + 13, NULL, 10);
+    } else if (strncmp(argv[i], "--cache-dir=", 12) == 0) {
+      free(cache_dir);
+      cache_dir = strdup(argv[i] + 12);
+    } else if (strncmp(argv[i], "--fusion-profile=", 17) == 0) {
+      fusion_profile = argv[i] + 17;
+    } else if (strcmp(argv[i], "--profile") == 0) {
+      profile_path = "ubf.profile";
+    } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+      profile_path = argv[i] + 10;
+    } else if (strcmp(argv[i], "--no-cache") == 0) {
+      free(cache_dir);
+      cache_dir = NULL;
+    } else if (argv[i][0] == '-' && argv[i][1] == 'O'
+               && argv[i][2] >= '0' && argv[i][2] <= '0' + UBF_OPT_LEVEL_MAX
+               && argv[i][3] == '\0') {
+      options.opt_level = argv[i][2] - '0';
+    } else if (strncmp(argv[i], "--no-pass=", 10) == 0) {
+      ubf_pass pass = ubf_find_pass(argv[i] + 10);
+      if (pass == UBF_PASS_COUNT) {
+        fprintf(stderr, "%s: unknown pass\n", argv[i] + 10);
+        return 1;
+      }
+      options.disabled_passes |= 1u << pass;
+    } else if (strcmp(argv[i], "--dump-ir") == 0) {
+      options.dump = stderr;
+    } else if (strcmp(argv[i], "--time-passes") == 0) {
+      options.stats = &compile_stats;
+    } else if (strcmp(argv[i], "--batch") == 0) {
+      batch_mode = true;
+    } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+      batch.threads = (unsigned) strtoul(argv[i] + 10, NULL, 10);
+    } else if (strncmp(argv[i], "--output-dir=", 13) == 0) {
+      batch.output = UBF_BATCH_FILES;
+      batch.output_dir = argv[i] + 13;
+    } else if (strcmp(argv[i], "--headers") == 0) {
+      batch.headers = true;
+    } else if (argv[i][0] != '-' && path == NULL) {
+      path = argv[i];
+    } else if (argv[i][0] != '-' && batch_mode) {
+      if (!add_input(&inputs, argv[i])) {
+        perror(argv[i]);
+        return 1;
+      }
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (batch_mode && (path == NULL || inputs.count == 0
+                     || profile_path != NULL)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (profile_path != NULL && engine != UBF_ENGINE_INTERPRETER) {
+    fprintf(stderr, "--profile: programs are always profiled in the "
+                    "interpreter, not with --engine\n");
+    return 1;
+  }
+  if (max_tape != 0 && max_tape < UBF_TAPE_MIN_LENGTH) {
+    fprintf(stderr, "--max-tape: the tape always has at least %d cells, so "
+                    "it can't be limited to fewer\n", UBF_TAPE_MIN_LENGTH);
+    return 1;
+  }
+
+  // when the program is read from a file, stdin is left for its own input
+  const char* name = (path != NULL) ? path : "stdin";
+  string_t code;
+  if (path != NULL ? !map_file(path, &code) : !read_stdin(&code)) {
+    perror(name);
+    return 1;
+  }
+
+  if (profile_path != NULL) {
+    ubf_vm_config_t config;
+    ubf_init_config(&config);
+    config.eof = eof;
+    config.cell_width = cell_width;
+    config.overflow = overflow;
+    config.fuel = fuel;
+    config.max_tape = max_tape;
+    config.max_output = max_output;
+    int status = run_profiled(name, &code, &options, &config, profile_path);
+    free_string(&code);
+    free(cache_dir);
+    return status;
+  }
+
+  ubf_program_t* program;
+  if (fusion_profile != NULL) {
+    // programs fused from a profile aren't cached, the cache is keyed by
+    // source alone
+    ubf_fusion_set_t fusions;
+    if (!ubf_load_fusion_profile(fusion_profile, &fusions)) {
+      perror(fusion_profile);
+      return 1;
+    }
+    program = ubf_compile_program_fused(code.string, code.length, &options,
+                                        &fusions);
+  } else if (cache_dir != NULL && options.disabled_passes == 0
+             && options.dump == NULL && options.stats == NULL) {
+    // nor are programs compiled without some passes, or to look at the
+    // compiler's work
+    program = load_cached(cache_dir, &code, &options);
+  } else {
+    program = ubf_compile_program_with_options(code.string, code.length,
+                                               &options);
+  }
+  if (options.stats != NULL) {
+    ubf_write_compile_stats(options.stats, stderr);
+  }
+  if (program == NULL) {
+    fprintf(stderr, "%s: %s\n", name, describe_result(UBF_COMPILE_ERROR));
+    free_string(&code);
+    free(cache_dir);
+    return 1;
+  }
+
+  int status = 0;
+  if (batch_mode) {
+    batch.inputs = (const char**) inputs.paths;
+    batch.count = inputs.count;
+    batch.engine = engine;
+    batch.eof = eof;
+    batch.cell_width = cell_width;
+    batch.overflow = overflow;
+    batch.fuel = fuel;
+    batch.max_tape = max_tape;
+    batch.max_output = max_output;
+    ubf_batch_stats_t stats;
+    if (!ubf_run_batch(program, &batch, &stats)) {
+      status = 1;
+    }
+    fprintf(stderr,
+            "%zu jobs (%zu failed) in %.3f s: %.1f jobs/s, "
+            "%.1f MB/s in, %.1f MB/s out\n",
+            stats.jobs, stats.failed, stats.seconds,
+            stats.jobs / stats.seconds,
+            stats.input_bytes / stats.seconds / 1e6,
+            stats.output_bytes / stats.seconds / 1e6);
+  } else {
+    ubf_vm_t* vm = ubf_init_vm();
+    vm->config.engine = engine;
+    vm->config.eof = eof;
+    vm->config.cell_width = cell_width;
+    vm->config.overflow = overflow;
+    vm->config.fuel = fuel;
+    vm->config.max_tape = max_tape;
+    vm->config.max_output = max_output;
+    ubf_interpret_result result = ubf_execute(vm, program);
+    if (result != UBF_OK) {
+      fprintf(stderr, "%s: %s\n", name, describe_result(result));
+      status = 1;
+    }
+    ubf_free_vm(vm);
+  }
+
+  ubf_release_program(program);
+
   free_string(&code);
+  free(cache_dir);
+  for (size_t i = 0; i < inputs.count; i++) {
+    free(inputs.paths[i]);
+  }
+  free(inputs.paths);
 
-  return 0;
+  return status;
 }